@@ -6,8 +6,13 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <math.h>
+#ifdef TFT_DEBUG
+#include <assert.h>
+#endif
 
 #include <defines.h>
 #include <spi.h>
@@ -15,27 +20,201 @@
 #include "ST7735.h"
 #include "font.h"
 
-static struct st7735_dev {
+/* Rectangle in screen pixels: from (x0, y0) to (x1 - 1, y1 - 1) */
+struct tft_rect {
+    uint8_t x0, y0, x1, y1;
+};
+
+/* Viewport with local coordinates and clip rectangle */
+struct tft_view {
+    struct tft_rect bounds;     // viewport on the screen
+    struct tft_rect clip;       // clip rectangle inside viewport
+    int16_t org_x;              // screen position of local (0, 0)
+    int16_t org_y;
+};
+
+struct st7735_dev {
     struct spi_device_s spi_dev;
     int16_t tft_cursor;     // current cursor position
     int16_t tft_cursor_x; // top-left corner x-coord of cursor in pixels
     int16_t tft_cursor_y; // top-left corner y-coord of cursor in pixels
     uint16_t tft_text_color;     // text color
     uint16_t tft_text_bg_color;  // background color
+    uint16_t text_lut[16];      // text color over background by 4-bit alpha
     uint8_t tft_flags;
-} st7735;
+    uint8_t text_scale;         // text scale factor [1:4]
+    tft_font font;              // proportional font; glyphs are NULL for 5x7 font
+    uint8_t font_w;             // char cell of current font
+    uint8_t font_h;
+#ifdef TFT_UTF8
+    uint32_t utf8_cp;           // code point of UTF-8 sequence being decoded
+    uint8_t utf8_left;          // continuation bytes left in sequence
+    uint8_t utf8_len;           // continuation bytes of sequence
+#endif
+    bool color12;               // 12-bit color mode
+    bool px_pending;            // unpaired pixel of 12-bit mode is pending
+    uint16_t px_pend;           // RGB444 unpaired pixel
+    uint8_t rotation;
+#if TFT_DEVICES > 1
+    uint8_t panel_w;            // panel size in pixels (in portrait)
+    uint8_t panel_h;
+    uint8_t col_off;            // panel position in display memory
+    uint8_t row_off;
+    uint8_t gram_w;             // size of display memory
+    uint8_t gram_h;
+#endif
+    uint8_t cursor_max_c;       // max text columns of char cell and rotation
+    uint8_t cursor_max_r;       // max text rows of char cell and rotation
+#ifndef TFT_ROTATION
+    uint8_t width;              // screen width in current rotation
+    uint8_t height;             // screen height in current rotation
+    uint8_t x_off;              // screen position in display memory
+    uint8_t y_off;              //   in current rotation
+#endif
+    uint8_t ptl_y;              // partial area start row (in panel rows)
+    uint8_t ptl_h;              // partial area height; 0 if partial mode off
+    uint8_t row_min;            // first row available for drawing
+    uint8_t row_max;            // last row available for drawing + 1
+    uint8_t col_min;            // first column available for drawing
+    uint8_t col_max;            // last column available for drawing + 1
+    struct tft_view view;       // current viewport
+    struct tft_view views[TFT_CLIP_DEPTH];  // saved by ST7735_push_viewport()
+    uint8_t view_cnt;           // number of saved viewports
+    bool partial_idle;          // idle mode is set by partial mode
+    const uint8_t *init_cmd;    // next command of init table
+    volatile uint8_t te_cnt;    // number of TE pulses from ST7735_te_isr()
+    bool te_irq;                // TE pulses are counted by interrupt
+#ifdef TFT_TICKS
+    uint8_t frame_te;           // TE counter at the start of last frame
+    uint16_t frame_start;       // TFT_TICKS() at the start of last frame
+    tft_frame_stats stats;
+#endif
+#if TFT_DEVICES > 1
+    FILE stream;                // stream of device (except the first one)
+#endif
+};
+
+static struct st7735_dev tft_devs[TFT_DEVICES];
+
+/* Current device. Constant with a single device */
+#if TFT_DEVICES > 1
+static struct st7735_dev *tft = &tft_devs[0];
+#else
+#define tft (&tft_devs[0])
+#endif
+
+/* Panel offsets in display memory, when rows or columns are mirrored */
+#define TFT_COL_OFFSET2 (TFT_GRAM_WIDTH - TFT_WIDTH - TFT_COL_OFFSET)
+#define TFT_ROW_OFFSET2 (TFT_GRAM_HEIGHT - TFT_HEIGHT - TFT_ROW_OFFSET)
+
+/* Panel geometry of current device. Constant with a single device */
+#if TFT_DEVICES > 1
+#define PANEL_W (tft->panel_w)
+#define PANEL_H (tft->panel_h)
+#define PANEL_COL_OFF (tft->col_off)
+#define PANEL_ROW_OFF (tft->row_off)
+#define PANEL_GRAM_H (tft->gram_h)
+#define PANEL_COL_OFF2 (tft->gram_w - tft->panel_w - tft->col_off)
+#define PANEL_ROW_OFF2 (tft->gram_h - tft->panel_h - tft->row_off)
+#else
+#define PANEL_W TFT_WIDTH
+#define PANEL_H TFT_HEIGHT
+#define PANEL_COL_OFF TFT_COL_OFFSET
+#define PANEL_ROW_OFF TFT_ROW_OFFSET
+#define PANEL_GRAM_H TFT_GRAM_HEIGHT
+#define PANEL_COL_OFF2 TFT_COL_OFFSET2
+#define PANEL_ROW_OFF2 TFT_ROW_OFFSET2
+#endif
+
+/* Screen position in display memory in rotation r.
+ * MX mirrors panel columns and MY mirrors panel rows, also when exchanged.
+ */
+#define rot_x_off(r) (((r) == 0) ? PANEL_COL_OFF : ((r) == 1) ? PANEL_ROW_OFF : \
+                      ((r) == 2) ? PANEL_COL_OFF2 : PANEL_ROW_OFF2)
+#define rot_y_off(r) (((r) == 0) ? PANEL_ROW_OFF : ((r) == 1) ? PANEL_COL_OFF2 : \
+                      ((r) == 2) ? PANEL_ROW_OFF2 : PANEL_COL_OFF)
+
+/* Character cell size at current text scale */
+#define CHAR_W (tft->font_w * tft->text_scale)
+#define CHAR_H (tft->font_h * tft->text_scale)
+
+/* Text grid size. Updated on change of char cell or rotation */
+#define CURSOR_MAX_C (tft->cursor_max_c)
+#define CURSOR_MAX_R (tft->cursor_max_r)
+
+/* Screen size and position in current rotation */
+#ifdef TFT_ROTATION
+#define TFT_ROT (TFT_ROTATION)
+#define TFT_W ((TFT_ROT & 1) ? PANEL_H : PANEL_W)
+#define TFT_H ((TFT_ROT & 1) ? PANEL_W : PANEL_H)
+#define TFT_X_OFF rot_x_off(TFT_ROT)
+#define TFT_Y_OFF rot_y_off(TFT_ROT)
+#else
+#define TFT_ROT (tft->rotation)
+#define TFT_W (tft->width)
+#define TFT_H (tft->height)
+#if (TFT_DEVICES > 1) || TFT_COL_OFFSET || TFT_ROW_OFFSET || TFT_COL_OFFSET2 || TFT_ROW_OFFSET2
+#define TFT_X_OFF (tft->x_off)
+#define TFT_Y_OFF (tft->y_off)
+#else
+#define TFT_X_OFF 0
+#define TFT_Y_OFF 0
+#endif
+#endif  /* TFT_ROTATION */
+
+/* MADCTL of rotation r: 0, 90, 180, 270 deg */
+#define rot_madctl(r) (((r) == 0) ? 0x00 : \
+                       ((r) == 1) ? (TFT_MADCTL_MV | TFT_MADCTL_MX) : \
+                       ((r) == 2) ? (TFT_MADCTL_MX | TFT_MADCTL_MY) : \
+                                    (TFT_MADCTL_MV | TFT_MADCTL_MY))
+
+/* Area available for drawing: clip rectangle of current viewport.
+ * Rows are limited to the partial area in partial mode too.
+ */
+#define TFT_ROW_MIN (tft->row_min)
+#define TFT_ROW_MAX (tft->row_max)
+#define TFT_COL_MIN (tft->col_min)
+#define TFT_COL_MAX (tft->col_max)
+
+/* Check arguments of unchecked primitives in debug build */
+#ifdef TFT_DEBUG
+#define tft_assert(e) assert(e)
+#else
+#define tft_assert(e) ((void)0)
+#endif
+
+/* Rectangle is not empty and inside the clip rectangle */
+#define in_clip(x, y, w, h) ((w) && (h) && \
+                             ((x) >= TFT_COL_MIN) && (((x) + (w)) <= TFT_COL_MAX) && \
+                             ((y) >= TFT_ROW_MIN) && (((y) + (h)) <= TFT_ROW_MAX))
+
+/* Translate local coordinates of current viewport to the screen */
+#define view_org(x, y) do { (x) += tft->view.org_x; (y) += tft->view.org_y; } while (0)
 
 /* Select Display */
-#define tft_sel() (bit_clear(*(st7735.spi_dev.cs.port), st7735.spi_dev.cs.pin_num))
+#define dev_cs_sel(dev) (bit_clear(*((dev)->spi_dev.cs.port), (dev)->spi_dev.cs.pin_num))
+#define tft_cs_sel() dev_cs_sel(tft)
 
 /* Deselect Display */
-#define tft_desel() (bit_set(*(st7735.spi_dev.cs.port), st7735.spi_dev.cs.pin_num))
+#define dev_cs_desel(dev) (bit_set(*((dev)->spi_dev.cs.port), (dev)->spi_dev.cs.pin_num))
+#define tft_cs_desel() dev_cs_desel(tft)
 
 /* Set Data mode */
-#define tft_data_mode() (bit_set(*(st7735.spi_dev.a0.port), st7735.spi_dev.a0.pin_num))
+#define dev_data_mode(dev) (bit_set(*((dev)->spi_dev.a0.port), (dev)->spi_dev.a0.pin_num))
+#define tft_data_mode() dev_data_mode(tft)
 
 /* Set Command mode */
-#define tft_command_mode() (bit_clear(*(st7735.spi_dev.a0.port), st7735.spi_dev.a0.pin_num))
+#define dev_command_mode(dev) (bit_clear(*((dev)->spi_dev.a0.port), (dev)->spi_dev.a0.pin_num))
+#define tft_command_mode() dev_command_mode(tft)
+
+#ifdef TFT_ASYNC_SPI
+/* Chip Select is driven by the transfer queue */
+#define tft_sel() ((void)0)
+#define tft_desel() do { px_flush(); queue_close(); } while (0)
+#else
+#define tft_sel() tft_cs_sel()
+#define tft_desel() do { px_flush(); tft_cs_desel(); } while (0)
+#endif
 
 /*!
  * @brief Convert HSV-color to RGB
@@ -102,6 +281,24 @@ color_rgb hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val) {
     return rgb;
 }
 
+/*!
+ * @brief Blend two RGB565 colors. Channels are blended at once
+ * in one 32-bit word (green is moved to upper half).
+ * @param fg Foreground 16-bit RGB565 color
+ * @param bg Background 16-bit RGB565 color
+ * @param alpha Opacity of foreground [0:32]
+ * @return Blended 16-bit RGB565 color
+ */
+uint16_t color_blend_565(uint16_t fg, uint16_t bg, uint8_t alpha) {
+    uint32_t f = (fg | ((uint32_t)fg << 16)) & 0x07E0F81FUL;
+    uint32_t b = (bg | ((uint32_t)bg << 16)) & 0x07E0F81FUL;
+
+    b += ((f - b) * alpha) >> 5;
+    b &= 0x07E0F81FUL;
+
+    return (uint16_t)(b | (b >> 16));
+}
+
 static inline void swap_int16(int16_t *a, int16_t *b) {
     int16_t temp = *a;
     *a = *b;
@@ -114,6 +311,15 @@ static inline void swap_uint8(uint8_t *a, uint8_t *b) {
     *b = temp;
 }
 
+static inline void px_flush(void);
+static void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+static void text_lut_upd(void);
+
+#ifndef TFT_ASYNC_SPI
+
+/* Wait for the end of all transfers. Nothing to wait in synchronous mode */
+#define tft_flush()
+
 /*!
  * @brief Send command
  * @param cmd Command
@@ -138,11 +344,11 @@ static inline void write_cmd_data(uint8_t cmd, uint8_t *data, size_t count) {
 }
 
 /*!
- * @brief Write 8-bit data
+ * @brief Write 8-bit data.
+ * Data mode is already set after \c write_command()
  * @param data Data to write
  */
 static inline void write_data(uint8_t data) {
-    tft_data_mode();
     spi_write(data);
 }
 
@@ -151,7 +357,6 @@ static inline void write_data(uint8_t data) {
  * @param data Data to write
  */
 static inline void write_data16(uint16_t data) {
-    tft_data_mode();
     spi_write16(data);
 }
 
@@ -160,30 +365,39 @@ static inline void write_data16(uint16_t data) {
  * @param data Data to write
  */
 static inline void write_data24(uint32_t data) {
-    tft_data_mode();
     spi_write24(data);
 }
 
 /*!
- * @brief Read 8-bit data after command
- * @param cmd Sending command
- * @return 8-bit data
+ * @brief Write 32-bit data
+ * @param data Data to write
  */
-static inline uint8_t read8(uint8_t cmd) {
-    uint8_t result;
-
-    tft_command_mode();
-    spi_write(cmd);
+static inline void write_data32(uint32_t data) {
+    spi_write32(data);
+}
 
-    tft_data_mode();
-    spi_set_speed(TFT_READ_FREQ);
-    set_input(PORTB, SPI_MOSI);
-    result = spi_read_8();
+/* Pixels are sent as they come */
+#define write_px16(data) write_data16(data)
+#define write_px24(data) write_data24(data)
 
-    spi_set_speed(TFT_WRITE_FREQ);
-    set_output(PORTB, SPI_MOSI);
+/*!
+ * @brief Write a run of the same 16-bit data
+ * @param data Data to write
+ * @param count Number of repeats
+ */
+static inline void write_rep16(uint16_t data, uint16_t count) {
+    while (count--)
+        spi_write16(data);
+}
 
-    return result;
+/*!
+ * @brief Write a run of the same 24-bit data
+ * @param data Data to write
+ * @param count Number of repeats
+ */
+static inline void write_rep24(uint32_t data, uint16_t count) {
+    while (count--)
+        spi_write24(data);
 }
 
 /*!
@@ -195,9 +409,13 @@ static inline uint8_t read8(uint8_t cmd) {
  * @param h Height of window
  */
 static inline void set_addr_window(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    x += TFT_X_OFF;
+    y += TFT_Y_OFF;
+
     uint32_t xa = ((uint32_t)x << 16U) | (x + w - 1U);
     uint32_t ya = ((uint32_t)y << 16U) | (y + h - 1U);
 
+    px_flush();
     write_command(ST7735_CASET);
     spi_write32(xa);
 
@@ -208,6 +426,505 @@ static inline void set_addr_window(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
     /* It is assumed that the next instruction will be to write pixels. */
 }
 
+#else   /* TFT_ASYNC_SPI */
+
+#if (TFT_QUEUE_SIZE < 16) || (TFT_QUEUE_SIZE > 256) || (TFT_QUEUE_SIZE & (TFT_QUEUE_SIZE - 1))
+#error "TFT_QUEUE_SIZE must be a power of 2 in range [16:256]"
+#endif
+
+#define Q_MASK (TFT_QUEUE_SIZE - 1)
+
+/* Queue records */
+#define Q_OP_CMD    0   // [cmd]
+#define Q_OP_DATA   1   // [count, data * count]
+#define Q_OP_WIN    2   // [x0, y0, x1, y1]
+#define Q_OP_FILL16 3   // [data_hi, data_lo, count_lo, count_hi]
+#define Q_OP_FILL24 4   // [data_hi, data_mid, data_lo, count_lo, count_hi]
+#define Q_OP_DEV    5   // [device number]
+
+#define Q_DATA_MAX  8   // max data bytes in one record
+#define Q_PX_MAX    (TFT_QUEUE_SIZE / 2)    // max data bytes in one pixel record
+
+static volatile uint8_t q_buf[TFT_QUEUE_SIZE];
+static volatile uint8_t q_head;     // end of published records
+static volatile uint8_t q_tail;     // next byte to read by ISR
+static uint8_t q_wr;                // end of record being written
+static volatile bool q_busy;        // transfer in progress
+static bool q_px_open;              // last record is pixel data being appended
+static uint8_t q_px_cnt;            // position of count of that record
+#if TFT_DEVICES > 1
+static struct st7735_dev *q_dev = tft_devs;    // device of last record
+#endif
+
+/* Transmitter state. Used only by ISR */
+static struct {
+    uint16_t fill_cnt;  // repeats left in the run
+    uint8_t fill[3];    // repeated data
+    uint8_t fill_len;   // length of repeated data
+    uint8_t fill_idx;   // next byte of repeated data
+    uint8_t data_cnt;   // data bytes left in the record
+    uint8_t seq[11];    // command sequence of window setup
+    uint8_t seq_idx;
+    uint8_t seq_len;
+    uint16_t seq_cmd;   // mask of command bytes in sequence
+    bool cmd;           // A0 is in command mode
+    struct st7735_dev *dev;     // device being sent to
+} q_st = {.dev = tft_devs};
+
+static inline uint8_t queue_pop(void) {
+    uint8_t b = q_buf[q_tail];
+    q_tail = (q_tail + 1) & Q_MASK;
+    return b;
+}
+
+/*!
+ * @brief Start sending next byte from the queue.
+ * Called from ISR when previous byte is sent.
+ */
+static void queue_service(void) {
+    uint8_t b;
+    bool cmd = false;
+
+    for (;;) {
+        if (q_st.fill_cnt) {
+            b = q_st.fill[q_st.fill_idx];
+            if (++q_st.fill_idx == q_st.fill_len) {
+                q_st.fill_idx = 0;
+                q_st.fill_cnt--;
+            }
+            break;
+        }
+        if (q_st.data_cnt) {
+            b = queue_pop();
+            q_st.data_cnt--;
+            break;
+        }
+        if (q_st.seq_idx < q_st.seq_len) {
+            cmd = q_st.seq_cmd & _BV(q_st.seq_idx);
+            b = q_st.seq[q_st.seq_idx++];
+            break;
+        }
+        if (q_tail == q_head) {
+            /* all sent */
+            bit_clear(SPCR, SPIE);
+            dev_cs_desel(q_st.dev);
+            q_busy = false;
+            return;
+        }
+
+        b = queue_pop();
+        switch (b) {
+            case Q_OP_CMD:
+                q_st.seq[0] = queue_pop();
+                q_st.seq_cmd = _BV(0);
+                q_st.seq_len = 1;
+                q_st.seq_idx = 0;
+                break;
+            case Q_OP_DATA:
+                q_st.data_cnt = queue_pop();
+                break;
+            case Q_OP_DEV:
+                /* pass the bus to another display between bytes */
+                dev_cs_desel(q_st.dev);
+                q_st.dev = &tft_devs[queue_pop()];
+                if (q_st.cmd)
+                    dev_command_mode(q_st.dev);
+                else
+                    dev_data_mode(q_st.dev);
+                dev_cs_sel(q_st.dev);
+                break;
+            case Q_OP_WIN:
+                q_st.seq[0] = ST7735_CASET;
+                q_st.seq[1] = 0;
+                q_st.seq[2] = queue_pop();  // x0
+                q_st.seq[3] = 0;
+                q_st.seq[5] = ST7735_RASET;
+                q_st.seq[6] = 0;
+                q_st.seq[7] = queue_pop();  // y0
+                q_st.seq[8] = 0;
+                q_st.seq[4] = queue_pop();  // x1
+                q_st.seq[9] = queue_pop();  // y1
+                q_st.seq[10] = ST7735_RAMWR;
+                q_st.seq_cmd = _BV(0) | _BV(5) | _BV(10);
+                q_st.seq_len = 11;
+                q_st.seq_idx = 0;
+                break;
+            case Q_OP_FILL16:
+            case Q_OP_FILL24:
+            default:
+                q_st.fill_len = 0;
+                q_st.fill[q_st.fill_len++] = queue_pop();
+                q_st.fill[q_st.fill_len++] = queue_pop();
+                if (b == Q_OP_FILL24)
+                    q_st.fill[q_st.fill_len++] = queue_pop();
+                q_st.fill_cnt = queue_pop();
+                q_st.fill_cnt |= (uint16_t)queue_pop() << 8;
+                q_st.fill_idx = 0;
+                break;
+        }
+    }
+
+    if (cmd != q_st.cmd) {
+        if (cmd)
+            dev_command_mode(q_st.dev);
+        else
+            dev_data_mode(q_st.dev);
+        q_st.cmd = cmd;
+    }
+    SPDR = b;
+}
+
+ISR(SPI_STC_vect) {
+    queue_service();
+}
+
+/*!
+ * @brief Let the transmitter progress while waiting.
+ * If interrupts are disabled, the queue is serviced by polling.
+ */
+static inline void queue_yield(void) {
+    if (!bit_is_set(SREG, SREG_I) && bit_is_set(SPSR, SPIF))
+        queue_service();
+}
+
+static inline void queue_push(uint8_t b) {
+    q_buf[q_wr] = b;
+    q_wr = (q_wr + 1) & Q_MASK;
+}
+
+/*!
+ * @brief Publish the written record and start the transmitter if it is idle
+ */
+static void queue_commit(void) {
+    uint8_t sreg = SREG;
+
+    cli();
+    q_head = q_wr;
+    if (!q_busy) {
+        q_busy = true;
+        q_st.seq_len = q_st.seq_idx = 0;
+        /* drop a pending flag of the last synchronous transfer */
+        (void)SPSR;
+        (void)SPDR;
+        /* A0 may be changed by direct transfers (init of another display) */
+        dev_data_mode(q_st.dev);
+        q_st.cmd = false;
+        dev_cs_sel(q_st.dev);
+        bit_set(SPCR, SPIE);
+        queue_service();
+    }
+    SREG = sreg;
+}
+
+/*!
+ * @brief Publish the open pixel record
+ */
+static inline void queue_close(void) {
+    if (q_px_open) {
+        q_px_open = false;
+        queue_commit();
+    }
+}
+
+/*!
+ * @brief Wait for free space in the queue for a new record.
+ * If another device is selected, the record of device change is put first.
+ * @param len Length of record
+ */
+static inline void queue_reserve(uint8_t len) {
+#if TFT_DEVICES > 1
+    bool dev_chg;
+#endif
+
+    /* the ISR can not free space while the pixel record is unpublished */
+    queue_close();
+#if TFT_DEVICES > 1
+    dev_chg = (q_dev != tft);
+
+    if (dev_chg)
+        len += 2;
+#endif
+    while (((q_tail - q_wr - 1) & Q_MASK) < len)
+        queue_yield();
+#if TFT_DEVICES > 1
+    if (dev_chg) {
+        queue_push(Q_OP_DEV);
+        queue_push(tft - tft_devs);
+        q_dev = tft;
+    }
+#endif
+}
+
+/* Wait for the end of all transfers */
+#define tft_flush() ST7735_wait_idle()
+
+static void write_data_buf(const uint8_t *data, size_t count) {
+    while (count) {
+        uint8_t n = (count > Q_DATA_MAX) ? Q_DATA_MAX : count;
+
+        queue_reserve(n + 2);
+        queue_push(Q_OP_DATA);
+        queue_push(n);
+        count -= n;
+        while (n--)
+            queue_push(*data++);
+        queue_commit();
+    }
+}
+
+static inline void write_command(uint8_t cmd) {
+    queue_reserve(2);
+    queue_push(Q_OP_CMD);
+    queue_push(cmd);
+    queue_commit();
+}
+
+static inline void write_cmd_data(uint8_t cmd, uint8_t *data, size_t count) {
+    write_command(cmd);
+    write_data_buf(data, count);
+}
+
+static inline void write_data(uint8_t data) {
+    write_data_buf(&data, 1);
+}
+
+static inline void write_data16(uint16_t data) {
+    queue_reserve(4);
+    queue_push(Q_OP_DATA);
+    queue_push(2);
+    queue_push(data >> 8);
+    queue_push(data);
+    queue_commit();
+}
+
+static inline void write_data24(uint32_t data) {
+    uint8_t buf[3] = {data >> 16, data >> 8, data};
+    write_data_buf(buf, 3);
+}
+
+/*!
+ * @brief Append pixel data to the open data record.
+ * Pixels of a window are gathered into one record that is published when
+ * it is full or before the next record, not on each pixel.
+ * @param data Pixel bytes
+ * @param n Number of bytes
+ */
+static void queue_px(const uint8_t *data, uint8_t n) {
+    if (q_px_open) {
+        if ((q_buf[q_px_cnt] + n > Q_PX_MAX)
+#if TFT_DEVICES > 1
+                || (q_dev != tft)
+#endif
+                || (((q_tail - q_wr - 1) & Q_MASK) < n))
+            queue_close();
+    }
+    if (!q_px_open) {
+        queue_reserve(n + 2);
+        queue_push(Q_OP_DATA);
+        q_px_cnt = q_wr;
+        queue_push(0);
+        q_px_open = true;
+    }
+    q_buf[q_px_cnt] += n;
+    while (n--)
+        queue_push(*data++);
+}
+
+static inline void write_px16(uint16_t data) {
+    uint8_t buf[2] = {data >> 8, data};
+    queue_px(buf, 2);
+}
+
+static inline void write_px24(uint32_t data) {
+    uint8_t buf[3] = {data >> 16, data >> 8, data};
+    queue_px(buf, 3);
+}
+
+static inline void write_data32(uint32_t data) {
+    uint8_t buf[4] = {data >> 24, data >> 16, data >> 8, data};
+    write_data_buf(buf, 4);
+}
+
+static inline void write_rep16(uint16_t data, uint16_t count) {
+    if (!count)
+        return;
+    queue_reserve(5);
+    queue_push(Q_OP_FILL16);
+    queue_push(data >> 8);
+    queue_push(data);
+    queue_push(count);
+    queue_push(count >> 8);
+    queue_commit();
+}
+
+static inline void write_rep24(uint32_t data, uint16_t count) {
+    if (!count)
+        return;
+    queue_reserve(6);
+    queue_push(Q_OP_FILL24);
+    queue_push(data >> 16);
+    queue_push(data >> 8);
+    queue_push(data);
+    queue_push(count);
+    queue_push(count >> 8);
+    queue_commit();
+}
+
+static inline void set_addr_window(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    x += TFT_X_OFF;
+    y += TFT_Y_OFF;
+
+    px_flush();
+    queue_reserve(5);
+    queue_push(Q_OP_WIN);
+    queue_push(x);
+    queue_push(y);
+    queue_push(x + w - 1U);
+    queue_push(y + h - 1U);
+    queue_commit();
+}
+
+#endif  /* TFT_ASYNC_SPI */
+
+/* 24-bit data of two 12-bit pixels */
+#define pack_444(a, b) (((uint32_t)(a) << 12U) | (b))
+
+/*!
+ * @brief Send the unpaired pixel of 12-bit mode
+ */
+static inline void px_flush(void) {
+    if (tft->px_pending) {
+        tft->px_pending = false;
+        write_px16(tft->px_pend << 4U);
+    }
+}
+
+/*!
+ * @brief Write one pixel to the current window.
+ * In 12-bit mode pixels are packed by pairs into 3 bytes; unpaired pixel
+ * waits for the next one or for the end of window.
+ * @param color 16-bit RGB565 color
+ */
+static inline void write_px(uint16_t color) {
+    if (!tft->color12) {
+        write_px16(color);
+        return;
+    }
+    color = rgb565_to_444(color);
+    if (tft->px_pending) {
+        tft->px_pending = false;
+        write_px24(pack_444(tft->px_pend, color));
+    } else {
+        tft->px_pend = color;
+        tft->px_pending = true;
+    }
+}
+
+/*!
+ * @brief Write a run of pixels of the same color to the current window
+ * @param color 16-bit RGB565 color
+ * @param count Number of pixels
+ */
+static inline void write_color(uint16_t color, uint16_t count) {
+    if (!tft->color12) {
+        write_rep16(color, count);
+        return;
+    }
+    if (!count)
+        return;
+    color = rgb565_to_444(color);
+    if (tft->px_pending) {
+        tft->px_pending = false;
+        write_data24(pack_444(tft->px_pend, color));
+        count--;
+    }
+    write_rep24(pack_444(color, color), count / 2);
+    if (count & 1) {
+        tft->px_pend = color;
+        tft->px_pending = true;
+    }
+}
+
+/* Switch SPI to reading (MOSI is released for bidirectional SDA line) */
+static inline void read_begin(void) {
+    spi_set_speed(TFT_READ_FREQ);
+    set_input(PORTB, SPI_MOSI);
+}
+
+/* Switch SPI back to writing */
+static inline void read_end(void) {
+    spi_set_speed(TFT_WRITE_FREQ);
+    set_output(PORTB, SPI_MOSI);
+#ifdef TFT_ASYNC_SPI
+    /* reading has driven A0 past the idle transmitter; leave it in data mode */
+    dev_data_mode(q_st.dev);
+    q_st.cmd = false;
+#endif
+}
+
+/*!
+ * @brief Read 8-bit data after command
+ * @param cmd Sending command
+ * @return 8-bit data
+ */
+static inline uint8_t read8(uint8_t cmd) {
+    uint8_t result;
+
+    tft_flush();
+    tft_command_mode();
+    spi_write(cmd);
+
+    tft_data_mode();
+    read_begin();
+    result = spi_read_8();
+    read_end();
+
+    return result;
+}
+
+/*!
+ * @brief Start reading of pixels from rectangle of display memory.
+ * Sends the window and RAMRD directly (bypassing the transfer queue),
+ * switches SPI to read speed and skips the dummy byte.
+ * Display must be selected.
+ * @param x Top left corner x coordinate
+ * @param y Top left corner y coordinate
+ * @param w Width of window
+ * @param h Height of window
+ */
+static void read_window(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    x += TFT_X_OFF;
+    y += TFT_Y_OFF;
+
+    tft_command_mode();
+    spi_write(ST7735_CASET);
+    tft_data_mode();
+    spi_write32(((uint32_t)x << 16U) | (x + w - 1U));
+    tft_command_mode();
+    spi_write(ST7735_RASET);
+    tft_data_mode();
+    spi_write32(((uint32_t)y << 16U) | (y + h - 1U));
+    tft_command_mode();
+    spi_write(ST7735_RAMRD);
+    tft_data_mode();
+
+    read_begin();
+    (void)spi_read_8();     // dummy read
+}
+
+/*!
+ * @brief Read one pixel after \c read_window().
+ * Memory is always read in 18-bit format (3 bytes per pixel).
+ * @return 16-bit RGB565 color
+ */
+static inline uint16_t read_px(void) {
+    uint8_t r = spi_read_8();
+    uint8_t g = spi_read_8();
+    uint8_t b = spi_read_8();
+
+    return color_565(r, g, b);
+}
+
 /*!
  * @brief Put a pixel to display on current coordinate.
  * Checking for entering the screen boundaries is not performed!
@@ -217,11 +934,40 @@ static inline void set_addr_window(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
  */
 static inline void write_pixel(uint8_t x, uint8_t y, uint16_t color) {
     set_addr_window(x, y, 1, 1);
-    spi_write16(color);
+    write_px(color);
+}
+
+/*!
+ * @brief Put a horizontal line from left to right.
+ * Checking for entering the screen boundaries is not performed!
+ * @param x0 Start X-coord
+ * @param y0 Start Y-coord
+ * @param w Length of line
+ * @param color 16-bit RGB565 color
+ */
+static inline void write_Hline(uint8_t x0, uint8_t y0, uint8_t w, uint16_t color) {
+    set_addr_window(x0, y0, w, 1);
+    write_color(color, w);
+}
+
+/*!
+ * @brief Put a Vertical line from up to down.
+ * Checking for entering the screen boundaries is not performed!
+ * @param x0 Start X-coord
+ * @param y0 Start Y-coord
+ * @param h Length of line
+ * @param color 16-bit RGB565 color
+ */
+static inline void write_Vline(uint8_t x0, uint8_t y0, uint8_t h, uint16_t color) {
+    set_addr_window(x0, y0, 1, h);
+    write_color(color, h);
 }
 
 /*!
- * @brief Write a line. Bresenham's algorithm
+ * @brief Write a line. Bresenham's algorithm.
+ * Pixels with the same minor coordinate are sent as one H/V-line burst.
+ * Line is clipped along the major axis once; runs out of the clip
+ * rectangle on the minor axis are skipped.
  * @param x0  Start point x coordinate
  * @param y0  Start point y coordinate
  * @param x1  End point x coordinate
@@ -231,70 +977,101 @@ static inline void write_pixel(uint8_t x, uint8_t y, uint16_t color) {
 static inline void write_line(int16_t x0, int16_t y0,
                               int16_t x1, int16_t y1,
                               uint16_t color) {
-    int16_t dx, dy, err;
+    int16_t dx, dy, err, run, a_min, a_max, b_min, b_max;
     int8_t ystep;
     bool angle = abs(y1 - y0) > abs(x1 - x0);
     if (angle) {
         swap_int16(&x0, &y0);
         swap_int16(&x1, &y1);
+        a_min = TFT_ROW_MIN;
+        a_max = TFT_ROW_MAX - 1;
+        b_min = TFT_COL_MIN;
+        b_max = TFT_COL_MAX - 1;
+    } else {
+        a_min = TFT_COL_MIN;
+        a_max = TFT_COL_MAX - 1;
+        b_min = TFT_ROW_MIN;
+        b_max = TFT_ROW_MAX - 1;
     }
 
     if (x0 > x1) {
         swap_int16(&x0, &x1);
         swap_int16(&y0, &y1);
     }
+    if ((x1 < a_min) || (x0 > a_max) ||
+        ((y0 < b_min) && (y1 < b_min)) || ((y0 > b_max) && (y1 > b_max)))
+        return;
 
     dx = x1 - x0;
     dy = abs(y1 - y0);
     err = dx / 2;
     ystep = (y0 < y1) ? 1 : -1;
 
-    for (; x0 <= x1; x0++) {
-        /* check that the pixels are within the screen */
-        if (angle) {
-            if ((x0 >= 0) && (x0 < TFT_HEIGHT) &&
-                (y0 >= 0) && (y0 < TFT_WIDTH)) {
-                write_pixel(y0, x0, color);
-            }
-        } else {
-            if ((y0 >= 0) && (y0 < TFT_HEIGHT) &&
-                (x0 >= 0) && (x0 < TFT_WIDTH)) {
-                write_pixel(x0, y0, color);
-            }
-        }
+    if (x0 < a_min) {
+        /* skip to the clip edge: minor steps are taken while err < 0 */
+        int32_t e = err - (int32_t)(a_min - x0) * dy;
+        int16_t m = (e < 0) ? (int16_t)((dx - 1 - e) / dx) : 0;
+
+        err = e + (int32_t)m * dx;
+        y0 += ystep * m;
+        x0 = a_min;
+    }
+    if (x1 > a_max)
+        x1 = a_max;
+
+    for (run = x0; x0 <= x1; x0++) {
         err -= dy;
-        if (err < 0) {
+        if ((err < 0) || (x0 == x1)) {
+            /* end of run */
+            if ((y0 >= b_min) && (y0 <= b_max)) {
+                if (angle)
+                    write_Vline(y0, run, x0 - run + 1, color);
+                else
+                    write_Hline(run, y0, x0 - run + 1, color);
+            }
+            run = x0 + 1;
             y0 += ystep;
             err += dx;
+            if ((ystep > 0) ? (y0 > b_max) : (y0 < b_min))
+                break;  // left the clip rectangle
         }
     }
 }
 
 /*!
- * @brief Put a horizontal line from left to right.
- * Checking for entering the screen boundaries is not performed!
- * @param x0 Start X-coord
- * @param y0 Start Y-coord
- * @param w Length of line
+ * @brief Put a horizontal span clipped by columns of the clip rectangle.
+ * Row must be within the clip rectangle.
+ * @param xs X-coord of one end
+ * @param xe X-coord of other end
+ * @param y Y-coord
  * @param color 16-bit RGB565 color
  */
-static inline void write_Hline(uint8_t x0, uint8_t y0, uint8_t w, uint16_t color) {
-    set_addr_window(x0, y0, w, 1);
-    for (uint8_t i = 0; i < w; i++)
-        spi_write16(color);
+static inline void write_span(int16_t xs, int16_t xe, int16_t y, uint16_t color) {
+    if (xs > xe)
+        swap_int16(&xs, &xe);
+    if (xs < TFT_COL_MIN)
+        xs = TFT_COL_MIN;
+    if (xe >= TFT_COL_MAX)
+        xe = TFT_COL_MAX - 1;
+    if (xs <= xe)
+        write_Hline(xs, y, xe - xs + 1, color);
 }
 
 /*!
- * @brief Put a Vertical line from up to down.
- * Checking for entering the screen boundaries is not performed!
- * @param x0 Start X-coord
- * @param y0 Start Y-coord
- * @param h Length of line
- * @param color 16-bit RGB565 color
+ * @brief Check a square around the circle against the clip rectangle
+ * @param x0 Center of circle. X-coord
+ * @param y0 Center of circle. Y-coord
+ * @param r Radius of circle
+ * @return 0 - circle is inside; 1 - partially visible; 2 - not visible
  */
-static inline void write_Vline(uint8_t x0, uint8_t y0, uint8_t h, uint16_t color) {
-    for (int16_t i = 0; i < h; i++)
-        write_pixel(x0, y0 + i, color);
+static uint8_t circle_clip(int16_t x0, int16_t y0, int16_t r) {
+    if (((x0 + r) < TFT_COL_MIN) || ((x0 - r) >= TFT_COL_MAX) ||
+        ((y0 + r) < TFT_ROW_MIN) || ((y0 - r) >= TFT_ROW_MAX))
+        return 2;
+    if (((x0 - r) >= TFT_COL_MIN) && ((x0 + r) < TFT_COL_MAX) &&
+        ((y0 - r) >= TFT_ROW_MIN) && ((y0 + r) < TFT_ROW_MAX))
+        return 0;
+    return 1;
 }
 
 /*!
@@ -304,27 +1081,38 @@ static inline void write_Vline(uint8_t x0, uint8_t y0, uint8_t h, uint16_t color
  * @param x X-coord for drawing
  * @param y Y-coord for drawing
  * @param color 16-bit RGB565 color
+ * @param clip \c false if the circle is inside the clip rectangle
  */
 static inline void write_circle(int16_t x_0, int16_t y_0,
-                                int16_t x, int16_t y, uint16_t color) {
-    /* with check that the pixels are within the screen */
+                                int16_t x, int16_t y, uint16_t color, bool clip) {
     int16_t y_tmp_pos = y_0 + y;
     int16_t y_tmp_neg = y_0 - y;
-
-    int16_t x_tmp = x_0 + x;
-    if ((x_tmp >= 0) && (x_tmp < TFT_WIDTH)) {
-        if ((y_tmp_pos >= 0) && (y_tmp_pos < TFT_HEIGHT))
-            write_pixel(x_tmp, y_tmp_pos, color);
-        if ((y_tmp_neg >= 0) && (y_tmp_neg < TFT_HEIGHT))
-            write_pixel(x_tmp, y_tmp_neg, color);
+    int16_t x_tmp_pos = x_0 + x;
+    int16_t x_tmp_neg = x_0 - x;
+
+    if (!clip) {
+        write_pixel(x_tmp_pos, y_tmp_pos, color);
+        write_pixel(x_tmp_pos, y_tmp_neg, color);
+        write_pixel(x_tmp_neg, y_tmp_pos, color);
+        write_pixel(x_tmp_neg, y_tmp_neg, color);
+        return;
     }
 
-    x_tmp = x_0 - x;
-    if ((x_tmp >= 0) && (x_tmp < TFT_WIDTH)) {
-        if ((y_tmp_pos >= 0) && (y_tmp_pos < TFT_HEIGHT))
-            write_pixel(x_tmp, y_tmp_pos, color);
-        if ((y_tmp_neg >= 0) && (y_tmp_neg < TFT_HEIGHT))
-            write_pixel(x_tmp, y_tmp_neg, color);
+    /* with check that the pixels are within the clip rectangle */
+    bool y_pos = (y_tmp_pos >= TFT_ROW_MIN) && (y_tmp_pos < TFT_ROW_MAX);
+    bool y_neg = (y_tmp_neg >= TFT_ROW_MIN) && (y_tmp_neg < TFT_ROW_MAX);
+
+    if ((x_tmp_pos >= TFT_COL_MIN) && (x_tmp_pos < TFT_COL_MAX)) {
+        if (y_pos)
+            write_pixel(x_tmp_pos, y_tmp_pos, color);
+        if (y_neg)
+            write_pixel(x_tmp_pos, y_tmp_neg, color);
+    }
+    if ((x_tmp_neg >= TFT_COL_MIN) && (x_tmp_neg < TFT_COL_MAX)) {
+        if (y_pos)
+            write_pixel(x_tmp_neg, y_tmp_pos, color);
+        if (y_neg)
+            write_pixel(x_tmp_neg, y_tmp_neg, color);
     }
 }
 
@@ -338,99 +1126,462 @@ static inline void write_circle(int16_t x_0, int16_t y_0,
  */
 static inline void write_fill_circle(int16_t x_0, int16_t y_0,
                                      int16_t x, int16_t y, uint16_t color) {
-    /* with heck that the pixels are within the screen */
+    /* clip the row once */
     int16_t x_start = x_0 - x;
-    if (x_start >= TFT_WIDTH)
-        return;
-    
+    int16_t x_end = x_0 + x + 1;
     int16_t y_p = y_0 + y;
     int16_t y_n = y_0 - y;
-    int16_t width = x * 2 + 1;
-    if (x_start < 0) {
-        if ((x_start + width) < 0)
-            return;
-        width += x_start;
-        x_start = 0;
-    }
-    if ((x_start + width) >= TFT_WIDTH)
-        width = TFT_WIDTH - x_start;
 
-    if ((y_p < TFT_HEIGHT) && (y_p >= 0))
-        write_Hline(x_start, y_p, width, color);
-    if ((y_n < TFT_HEIGHT) && (y_n >= 0))
-        write_Hline(x_start, y_n, width, color);
+    if (x_start < TFT_COL_MIN)
+        x_start = TFT_COL_MIN;
+    if (x_end > TFT_COL_MAX)
+        x_end = TFT_COL_MAX;
+    if (x_start >= x_end)
+        return;
+
+    if ((y_p < TFT_ROW_MAX) && (y_p >= TFT_ROW_MIN))
+        write_Hline(x_start, y_p, x_end - x_start, color);
+    if ((y_n < TFT_ROW_MAX) && (y_n >= TFT_ROW_MIN))
+        write_Hline(x_start, y_n, x_end - x_start, color);
 }
 
 /*!
  * @param num if >0 - increment; if <0 - decrement
  */
 static void cursor_upd(int8_t num) {
-    if (st7735.tft_flags & _BV(TFT_PIX_TEXT)) {
-        st7735.tft_cursor_x += num * (FONT_5X7_WIDTH + 1);
+    if (tft->tft_flags & _BV(TFT_PIX_TEXT)) {
+        tft->tft_cursor_x += num * CHAR_W;
         return;
     }
-    if (((st7735.tft_cursor % TFT_CURSOR_MAX_C) < (TFT_CURSOR_MAX_C - 1)) ||
-        (st7735.tft_flags & _BV(TFT_WRAP_TEXT))) {
-        st7735.tft_cursor += num;
+    if (((tft->tft_cursor % CURSOR_MAX_C) < (CURSOR_MAX_C - 1)) ||
+        (tft->tft_flags & _BV(TFT_WRAP_TEXT))) {
+        tft->tft_cursor += num;
+
+        if (tft->tft_cursor >= (CURSOR_MAX_C * CURSOR_MAX_R)) {
+            tft->tft_cursor -= ((tft->tft_cursor / (CURSOR_MAX_C * CURSOR_MAX_R)) *
+                                  (CURSOR_MAX_C * CURSOR_MAX_R));
+            fill_rect(0, 0, TFT_W, CHAR_H * 2,
+                      tft->tft_text_bg_color);
+        }
+    }
+
+    tft->tft_cursor_x = (tft->tft_cursor % CURSOR_MAX_C) * CHAR_W;
+    tft->tft_cursor_y = (tft->tft_cursor / CURSOR_MAX_C) * CHAR_H;
+}
+
+#ifdef TFT_DISPLAY_LIST
+
+/* Display list opcodes */
+#define DL_COLOR            0x01    // [color16] set color for next ops
+#define DL_FILL             0x02    // [x, y, w, h] clipped fill window
+#define DL_LINE             0x03    // [x0, y0, x1, y1]
+#define DL_RECT             0x04    // [x, y, w, h]
+#define DL_CIRCLE_B         0x05    // [x0, y0, r]
+#define DL_CIRCLE_M         0x06    // [x0, y0, r]
+#define DL_FILL_CIRCLE_B    0x07    // [x0, y0, r]
+#define DL_FILL_CIRCLE_M    0x08    // [x0, y0, r]
+#define DL_TRIANGLE         0x09    // [x0, y0, x1, y1, x2, y2]
+#define DL_FILL_TRIANGLE    0x0A    // [x0, y0, x1, y1, x2, y2]
+
+#define DL_NONE 0xFFFFU
+
+static struct {
+    uint8_t *buf;       // recording buffer; NULL if not recording
+    uint16_t size;      // size of buffer
+    uint16_t len;       // length of recorded list
+    uint16_t last;      // offset of last DL_FILL op (to merge); DL_NONE if no
+    uint16_t color;     // current color of list
+    bool color_set;     // \c color is valid
+    bool ovf;           // buffer overflow
+} dl;
+
+static void dl_put(uint8_t b) {
+    if (dl.len < dl.size)
+        dl.buf[dl.len++] = b;
+    else
+        dl.ovf = true;
+}
+
+static void dl_put16(uint16_t w) {
+    dl_put((uint8_t)w);
+    dl_put(w >> 8);
+}
+
+static void dl_op(uint8_t op, uint16_t color) {
+    if (!dl.color_set || (dl.color != color)) {
+        dl_put(DL_COLOR);
+        dl_put16(color);
+        dl.color = color;
+        dl.color_set = true;
+        dl.last = DL_NONE;
+    }
+    dl_put(op);
+}
+
+/*!
+ * @brief Record a shape with 16-bit arguments to display list
+ * @param op Opcode
+ * @param color 16-bit RGB565 color
+ * @param argc Number of arguments
+ * @return \c true if recording is on and shape shall not be drawn
+ */
+static bool dl_shape(uint8_t op, uint16_t color, uint8_t argc, ...) {
+    va_list ap;
+
+    if (!dl.buf)
+        return false;
+
+    dl_op(op, color);
+    va_start(ap, argc);
+    while (argc--)
+        dl_put16((uint16_t)va_arg(ap, int));
+    va_end(ap);
+    dl.last = DL_NONE;
+
+    return true;
+}
+
+/*!
+ * @brief Record a clipped fill window to display list.
+ * Adjacent windows of the same color are merged into one.
+ * @param x X-corner of window
+ * @param y Y-corner of window
+ * @param w Width of window
+ * @param h Height of window
+ * @param color 16-bit RGB565 color
+ * @return \c true if recording is on and window shall not be drawn
+ */
+static bool dl_fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (!dl.buf)
+        return false;
+    if ((w <= 0) || (h <= 0))
+        return true;
+
+    if ((dl.last != DL_NONE) && (dl.color == color)) {
+        uint8_t *l = &dl.buf[dl.last + 1];
+
+        if ((l[0] == x) && (l[2] == w) && ((l[1] + l[3]) == y)) {
+            l[3] += h;
+            return true;
+        }
+        if ((l[1] == y) && (l[3] == h) && ((l[0] + l[2]) == x)) {
+            l[2] += w;
+            return true;
+        }
+    }
+
+    dl_op(DL_FILL, color);
+    dl.last = dl.len - 1;
+    dl_put(x);
+    dl_put(y);
+    dl_put(w);
+    dl_put(h);
+    if (dl.ovf)
+        dl.last = DL_NONE;
+
+    return true;
+}
+
+#else
+
+#define dl_shape(...) false
+#define dl_fill(...) false
+
+#endif  /* TFT_DISPLAY_LIST */
+
+/*!
+ * @brief Intersect a rectangle with another one
+ * @param r Rectangle; empty if there is no intersection
+ * @param x X-corner of another rectangle (screen)
+ * @param y Y-corner of another rectangle (screen)
+ * @param w Width of another rectangle
+ * @param h Height of another rectangle
+ */
+static void rect_clip(struct tft_rect *r, int16_t x, int16_t y, int16_t w, int16_t h) {
+    int16_t x1 = x + w;
+    int16_t y1 = y + h;
+
+    if (x > r->x0)
+        r->x0 = (x < r->x1) ? x : r->x1;
+    if (x1 < r->x1)
+        r->x1 = (x1 > r->x0) ? x1 : r->x0;
+    if (y > r->y0)
+        r->y0 = (y < r->y1) ? y : r->y1;
+    if (y1 < r->y1)
+        r->y1 = (y1 > r->y0) ? y1 : r->y0;
+}
 
-        if (st7735.tft_cursor >= (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R)) {
-            st7735.tft_cursor -= ((st7735.tft_cursor / (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R)) *
-                                  (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R));
-            ST7735_draw_fill_rect(0, 0, TFT_WIDTH, (FONT_5X7_HEIGHT + 1) * 2,
-                                  st7735.tft_text_bg_color);
+/*!
+ * @brief Update area available for drawing by clip rectangle, partial area
+ * and rotation. Partial area is a band of panel rows: screen rows in portrait
+ * and screen columns in landscape, mirrored in rotations 2 and 3.
+ */
+static void update_clip(void) {
+    const struct tft_rect *clip = &tft->view.clip;
+    uint8_t x0 = 0;
+    uint8_t x1 = TFT_W;
+    uint8_t y0 = 0;
+    uint8_t y1 = TFT_H;
+
+    if (tft->ptl_h) {
+        uint8_t start = (TFT_ROT < 2) ? tft->ptl_y : PANEL_H - tft->ptl_y - tft->ptl_h;
+
+        if (TFT_ROT & 1) {
+            x0 = start;
+            x1 = start + tft->ptl_h;
+        } else {
+            y0 = start;
+            y1 = start + tft->ptl_h;
         }
     }
 
-    st7735.tft_cursor_x = (st7735.tft_cursor % TFT_CURSOR_MAX_C) * (FONT_5X7_WIDTH + 1);
-    st7735.tft_cursor_y = (st7735.tft_cursor / TFT_CURSOR_MAX_C) * (FONT_5X7_HEIGHT + 1);
+    tft->col_min = (clip->x0 > x0) ? clip->x0 : x0;
+    tft->col_max = (clip->x1 < x1) ? clip->x1 : x1;
+    if (tft->col_max < tft->col_min)
+        tft->col_max = tft->col_min;
+    tft->row_min = (clip->y0 > y0) ? clip->y0 : y0;
+    tft->row_max = (clip->y1 < y1) ? clip->y1 : y1;
+    if (tft->row_max < tft->row_min)
+        tft->row_max = tft->row_min;
+}
+
+/*!
+ * @brief Close all viewports and reset clip rectangle to the whole screen
+ */
+static void reset_views(void) {
+    tft->view.bounds.x0 = 0;
+    tft->view.bounds.y0 = 0;
+    tft->view.bounds.x1 = TFT_W;
+    tft->view.bounds.y1 = TFT_H;
+    tft->view.clip = tft->view.bounds;
+    tft->view.org_x = 0;
+    tft->view.org_y = 0;
+    tft->view_cnt = 0;
+    update_clip();
+}
+
+/*!
+ * @brief Update screen size and position in display memory to rotation
+ * and panel of selected device. Clipping bounds and text grid are changed
+ * to the new screen size, all viewports are closed.
+ */
+static void screen_upd(void) {
+#ifndef TFT_ROTATION
+    if (TFT_ROT & 1) {
+        tft->width = PANEL_H;
+        tft->height = PANEL_W;
+    } else {
+        tft->width = PANEL_W;
+        tft->height = PANEL_H;
+    }
+    tft->x_off = rot_x_off(TFT_ROT);
+    tft->y_off = rot_y_off(TFT_ROT);
+#endif
+    tft->cursor_max_c = TFT_W / CHAR_W;
+    tft->cursor_max_r = TFT_H / CHAR_H;
+    reset_views();
+
+    tft->tft_cursor %= CURSOR_MAX_C * CURSOR_MAX_R;
+    if (!(tft->tft_flags & _BV(TFT_PIX_TEXT))) {
+        tft->tft_cursor_x = (tft->tft_cursor % CURSOR_MAX_C) * CHAR_W;
+        tft->tft_cursor_y = (tft->tft_cursor / CURSOR_MAX_C) * CHAR_H;
+    }
+}
+
+/*!
+ * @brief Get stream of device
+ * @param dev Device
+ * @return Stream. \c st7735_stream for the first device
+ */
+static FILE *dev_stream(struct st7735_dev *dev) {
+#if TFT_DEVICES > 1
+    if (dev != tft_devs)
+        return &dev->stream;
+#else
+    (void)dev;
+#endif
+    return &st7735_stream;
+}
+
+/*!
+ * @brief Get device handle
+ * @param num Device number [0:TFT_DEVICES-1]
+ * @return Device handle; NULL if there is no such device
+ */
+st7735_dev_t *ST7735_get_dev(uint8_t num) {
+    if (num >= TFT_DEVICES)
+        return NULL;
+    return &tft_devs[num];
+}
+
+/*!
+ * @brief Select the device used by all other functions.
+ * Device 0 is selected by default. Transfers already queued
+ * to the previous device are not waited for: the queue passes
+ * the bus between displays by Chip Select.
+ * @param dev Device handle
+ */
+void ST7735_select(st7735_dev_t *dev) {
+#if TFT_DEVICES > 1
+    if (dev)
+        tft = dev;
+#else
+    (void)dev;
+#endif
+}
+
+/*!
+ * @brief Get selected device
+ * @return Device handle
+ */
+st7735_dev_t *ST7735_selected(void) {
+    return tft;
+}
+
+#if TFT_DEVICES > 1
+/*!
+ * @brief Set panel geometry of selected device, if it differs from
+ * \c TFT_WIDTH, \c TFT_HEIGHT and offsets. Call it after \c ST7735_init().
+ * Display memory is assumed to center the panel, as \c TFT_GRAM_WIDTH
+ * and \c TFT_GRAM_HEIGHT by default. All viewports are closed.
+ * @param width Panel width in pixels (in portrait)
+ * @param height Panel height in pixels (in portrait)
+ * @param col_off First column of panel in display memory
+ * @param row_off First row of panel in display memory
+ */
+void ST7735_set_panel(uint8_t width, uint8_t height, uint8_t col_off, uint8_t row_off) {
+    if (!width || !height)
+        return;
+
+    tft->panel_w = width;
+    tft->panel_h = height;
+    tft->col_off = col_off;
+    tft->row_off = row_off;
+    tft->gram_w = width + 2 * col_off;
+    tft->gram_h = height + 2 * row_off;
+    screen_upd();
 }
+#endif
+
+/* Rotation, size and position of screen after init */
+#ifdef TFT_ROTATION
+#define INIT_ROT (TFT_ROTATION)
+#else
+#define INIT_ROT 0
+#endif
+#define INIT_W ((INIT_ROT & 1) ? TFT_HEIGHT : TFT_WIDTH)
+#define INIT_H ((INIT_ROT & 1) ? TFT_WIDTH : TFT_HEIGHT)
+
+/* Init table: for every command:
+ * command, number of args (| INIT_DELAY), args, [delay in ms];
+ * ends with NOP with INIT_END flag.
+ */
+#define INIT_DELAY 0x80
+#define INIT_END 0x40
+#define INIT_ARGS_MAX 4
+
+static const uint8_t init_cmds[] PROGMEM = {
+    ST7735_SLPOUT, INIT_DELAY,          // out of sleep mode
+        TFT_SLPOUT_WAIT,
+    ST7735_COLMOD, 1,                   // 16-bit color mode
+        0b101,
+#ifdef TFT_ROTATION
+    ST7735_MADCTL, 1,
+        rot_madctl(INIT_ROT),
+#endif
+#if TFT_DEVICES == 1
+    /* with several devices panel may differ; drawing sets own window */
+    ST7735_CASET, 4,                    // full screen window
+        0x00, rot_x_off(INIT_ROT),
+        0x00, rot_x_off(INIT_ROT) + INIT_W - 1,
+    ST7735_RASET, 4,
+        0x00, rot_y_off(INIT_ROT),
+        0x00, rot_y_off(INIT_ROT) + INIT_H - 1,
+#endif
+    ST7735_GAMSET, 1,                   // gamma curve 2
+        0x02,
+    ST7735_DISPON, 0,                   // display on
+    ST7735_NOP, INIT_END
+};
 
 /*!
- * @brief Initial display sequence
+ * @brief Start initialization of selected device: setup pins and state,
+ * and reset display. Continue it by \c ST7735_init_poll() after
+ * returned time, doing other things in the meantime.
  * @param cs_num Chip Select (SS) pin number
  * @param cs_port Chip Select port pointer
  * @param a0_num Data/Command (DC) pin number
  * @param a0_port Data/Command port pointer
  * @param rst_num Reset (RST) pin number
  * @param rst_port Reset port pointer
+ * @return Time in ms to wait before \c ST7735_init_poll()
  */
-void ST7735_init(uint8_t cs_num, volatile uint8_t *cs_port,
-                 uint8_t a0_num, volatile uint8_t *a0_port,
-                 uint8_t rst_num, volatile uint8_t *rst_port) {
+uint8_t ST7735_init_begin(uint8_t cs_num, volatile uint8_t *cs_port,
+                          uint8_t a0_num, volatile uint8_t *a0_port,
+                          uint8_t rst_num, volatile uint8_t *rst_port) {
     uint8_t sreg = SREG;
 
+    tft_flush();        // bus may be busy with another display
     cli();
 
-    st7735.spi_dev.cs.pin_num = cs_num;
-    st7735.spi_dev.cs.port = cs_port;
-    st7735.spi_dev.a0.pin_num = a0_num;
-    st7735.spi_dev.a0.port = a0_port;
-    st7735.spi_dev.rst.pin_num = rst_num;
-    st7735.spi_dev.rst.port = rst_port;
-    st7735.spi_dev.intr.pin_num = 0;
-    st7735.spi_dev.intr.port = NULL;
-
-    tft_desel();        // deselect
+    tft->spi_dev.cs.pin_num = cs_num;
+    tft->spi_dev.cs.port = cs_port;
+    tft->spi_dev.a0.pin_num = a0_num;
+    tft->spi_dev.a0.port = a0_port;
+    tft->spi_dev.rst.pin_num = rst_num;
+    tft->spi_dev.rst.port = rst_port;
+    tft->spi_dev.intr.pin_num = 0;
+    tft->spi_dev.intr.port = NULL;
+    tft->te_irq = false;
+
+    tft_cs_desel();     // deselect
     tft_data_mode();    // data mode
 
-    set_output(*(st7735.spi_dev.cs.port - 1), st7735.spi_dev.cs.pin_num);
-    set_output(*(st7735.spi_dev.a0.port - 1), st7735.spi_dev.a0.pin_num);
-    set_output(*(st7735.spi_dev.rst.port - 1), st7735.spi_dev.rst.pin_num);
+    set_output(*(tft->spi_dev.cs.port - 1), tft->spi_dev.cs.pin_num);
+    set_output(*(tft->spi_dev.a0.port - 1), tft->spi_dev.a0.pin_num);
+    set_output(*(tft->spi_dev.rst.port - 1), tft->spi_dev.rst.pin_num);
     
-    bit_set(*(st7735.spi_dev.rst.port), st7735.spi_dev.rst.pin_num);    // toogle RST low to reset
-    _delay_ms(120);
-    bit_clear(*(st7735.spi_dev.rst.port), st7735.spi_dev.rst.pin_num);
-    _delay_ms(20);
-    bit_set(*(st7735.spi_dev.rst.port), st7735.spi_dev.rst.pin_num);
-    _delay_ms(150);
+    /* RST low pulse to reset; min 10 us */
+    bit_clear(*(tft->spi_dev.rst.port), tft->spi_dev.rst.pin_num);
+    _delay_us(10);
+    bit_set(*(tft->spi_dev.rst.port), tft->spi_dev.rst.pin_num);
     
-    st7735.tft_cursor = 0;
-    st7735.tft_cursor_x = st7735.tft_cursor_y = 0;
-    st7735.tft_text_color = 0xFF;
-    st7735.tft_text_bg_color = 0x00;
-    st7735.tft_flags = 0;
-
-    fdev_setup_stream(&st7735_stream, ST7735_put_char, NULL, _FDEV_SETUP_WRITE);
+    tft->tft_cursor = 0;
+    tft->tft_cursor_x = tft->tft_cursor_y = 0;
+    tft->tft_text_color = 0xFF;
+    tft->tft_text_bg_color = 0x00;
+    text_lut_upd();
+    tft->tft_flags = 0;
+    tft->text_scale = 1;
+#ifdef TFT_UTF8
+    tft->utf8_left = 0;
+#endif
+    tft->font.glyphs = NULL;
+    tft->font_w = FONT_5X7_WIDTH + 1;
+    tft->font_h = FONT_5X7_HEIGHT + 1;
+    tft->color12 = false;
+    tft->px_pending = false;
+#ifdef TFT_ROTATION
+    tft->rotation = TFT_ROTATION;
+#else
+    tft->rotation = 0;
+#endif
+#if TFT_DEVICES > 1
+    tft->panel_w = TFT_WIDTH;
+    tft->panel_h = TFT_HEIGHT;
+    tft->col_off = TFT_COL_OFFSET;
+    tft->row_off = TFT_ROW_OFFSET;
+    tft->gram_w = TFT_GRAM_WIDTH;
+    tft->gram_h = TFT_GRAM_HEIGHT;
+#endif
+    tft->ptl_h = 0;
+    tft->partial_idle = false;
+    screen_upd();
+    tft->init_cmd = init_cmds;
+
+    FILE *stream = dev_stream(tft);
+    fdev_setup_stream(stream, ST7735_put_char, NULL, _FDEV_SETUP_WRITE);
+    fdev_set_udata(stream, tft);
 
     /*
     Set SPI speed for this display. Write speed by default
@@ -442,32 +1593,74 @@ void ST7735_init(uint8_t cs_num, volatile uint8_t *cs_port,
     /* set write speed as default */
     spi_set_speed(TFT_WRITE_FREQ);
 
-    tft_sel();
+    SREG = sreg;
 
-    write_command(ST7735_SLPOUT);
-    _delay_ms(120);
-    write_command(ST7735_DISPON);
-    _delay_ms(120);
+    return TFT_RESET_WAIT;
+}
 
-    uint8_t data = 0b101;
-    write_cmd_data(ST7735_COLMOD, &data, 1);   // set 16-bit Color Mode
+/*!
+ * @brief Continue initialization of selected device. Sends commands
+ * of init table until the next delay.
+ * @return Time in ms to wait before next call; 0 if init is done
+ */
+uint8_t ST7735_init_poll(void) {
+    uint8_t args[INIT_ARGS_MAX];
+    uint8_t wait = 0;
 
-    uint8_t write_data[4] = {
-        0x00, 0x00,     /* X Start = 0 */
-        0x00, 0x7F      /* X End = 127 */
-    };
-    write_cmd_data(ST7735_CASET, write_data, 4);
-    
-    write_data[0] = write_data[1] = 0x00;   // Y Start = 0
-    write_data[2] = 0x00; write_data[3] = 0x9F;   // Y End = 159
-    write_cmd_data(ST7735_RASET, write_data, 4);
+    tft_sel();
+    while (!wait) {
+        uint8_t cmd = pgm_read_byte(tft->init_cmd);
+        uint8_t n = pgm_read_byte(tft->init_cmd + 1);
 
-    data = 0x02;
-    write_cmd_data(ST7735_GAMSET, &data, 1);
-    
+        if (n & INIT_END)
+            break;
+        tft->init_cmd += 2;
+        memcpy_P(args, tft->init_cmd, n & ~INIT_DELAY);
+        tft->init_cmd += n & ~INIT_DELAY;
+        if (n & INIT_DELAY)
+            wait = pgm_read_byte(tft->init_cmd++);
+        write_cmd_data(cmd, args, n & ~INIT_DELAY);
+    }
     tft_desel();
+    tft_flush();    // delay starts when commands are sent
 
-    SREG = sreg;
+    return wait;
+}
+
+/*!
+ * @brief Initial display sequence of selected device.
+ * Same as \c ST7735_init_begin() and \c ST7735_init_poll() with delays.
+ * @param cs_num Chip Select (SS) pin number
+ * @param cs_port Chip Select port pointer
+ * @param a0_num Data/Command (DC) pin number
+ * @param a0_port Data/Command port pointer
+ * @param rst_num Reset (RST) pin number
+ * @param rst_port Reset port pointer
+ */
+void ST7735_init(uint8_t cs_num, volatile uint8_t *cs_port,
+                 uint8_t a0_num, volatile uint8_t *a0_port,
+                 uint8_t rst_num, volatile uint8_t *rst_port) {
+    uint8_t ms = ST7735_init_begin(cs_num, cs_port, a0_num, a0_port, rst_num, rst_port);
+
+    while (ms) {
+        while (ms--)
+            _delay_ms(1);
+        ms = ST7735_init_poll();
+    }
+}
+
+/*!
+ * @brief Wait until all queued transfers to the display are done.
+ * In synchronous mode (without \c TFT_ASYNC_SPI) returns immediately.
+ * If interrupts are disabled, the queue is sent by polling.
+ */
+void ST7735_wait_idle(void) {
+#ifdef TFT_ASYNC_SPI
+    px_flush();
+    queue_close();
+    while (q_busy)
+        queue_yield();
+#endif
 }
 
 /*!
@@ -494,336 +1687,1419 @@ void ST7735_idle_mode(bool val) {
 }
 
 /*!
- * @brief Fill the screen with one color
- * @param rgb565 16-bit 5-6-5 Color to fill
+ * @brief Enable the Tearing Effect output of display (V-blanking only)
+ * and set the pin it is connected to.
+ * @param te_num TE pin number
+ * @param te_port TE port pointer
  */
-void ST7735_fill_screen(uint16_t rgb565) {
-    tft_sel();
+void ST7735_te_on(uint8_t te_num, volatile uint8_t *te_port) {
+    uint8_t data = 0x00;    // TELOM = 0: V-blanking only
 
-    set_addr_window(0, 0, TFT_WIDTH, TFT_HEIGHT);
+    tft->spi_dev.intr.pin_num = te_num;
+    tft->spi_dev.intr.port = te_port;
+    set_input(*(te_port - 1), te_num);
 
-    for (uint16_t i = 0; i < (TFT_WIDTH * TFT_HEIGHT); i++) {
-        spi_write16(rgb565);
-    }
+#ifdef TFT_TICKS
+    tft->stats.frames = 0;
+    tft->stats.missed = 0;
+    tft->stats.update_time = 0;
+    tft->stats.max_update_time = 0;
+#endif
 
+    tft_sel();
+    write_cmd_data(ST7735_TEON, &data, 1);
     tft_desel();
 }
 
 /*!
- * @brief Draw the HSV-color palette
+ * @brief Disable the Tearing Effect output of display
  */
-void ST7735_draw_HSV(void) {
-    float hue = 0.0F;
-    float val;
-    float sat;
-    color_rgb rgb;
-
+void ST7735_te_off(void) {
     tft_sel();
-
-    set_addr_window(0, 0, TFT_WIDTH, TFT_HEIGHT);
-
-    for (uint8_t y = 0; y < TFT_HEIGHT; y++){
-        val = 100.0F;
-        sat = 0.0F;
-        for (uint8_t x = 0; x < (TFT_WIDTH / 2); x++) {
-            rgb = hsv_to_rgb((uint16_t)hue, (uint8_t)sat, (uint8_t)val);
-            spi_write16(color_565(rgb.red, rgb.green, rgb.blue));
-            sat += (0.78125F * 2);
-        }
-        sat = 100.0F;
-        for (uint8_t x = 0; x < (TFT_WIDTH / 2); x++) {
-            rgb = hsv_to_rgb((uint16_t)hue, (uint8_t)sat, (uint8_t)val);
-            spi_write16(color_565(rgb.red, rgb.green, rgb.blue));
-            val -= (0.78125F * 2);
-        }
-        hue += 2.25F;
-    }
-
+    write_command(ST7735_TEOFF);
     tft_desel();
+
+    tft->spi_dev.intr.port = NULL;
+    tft->te_irq = false;
 }
 
 /*!
- * @brief Draw a single pixel to the display
- * @param x X-coordinate to draw
- * @param y Y-coordinate to draw
+ * @brief Count the TE pulse of device. Call it from the interrupt handler
+ * of TE pin (rising edge). Without it, TE pin is polled.
+ * @param dev Device handle
  */
-void ST7735_draw_pixel(int16_t x, int16_t y, uint16_t color) {
-    if ((x >= TFT_WIDTH) || (x < 0) ||
-        (y >= TFT_HEIGHT) || (y < 0))
-        return;
-    
-    tft_sel();
-    write_pixel((uint8_t)x, (uint8_t)y, color);
-    tft_desel();
+void ST7735_te_isr_dev(st7735_dev_t *dev) {
+    dev->te_cnt++;
+    dev->te_irq = true;
 }
 
 /*!
- * @brief Draw a line
- * @param x0 Start X-coord
- * @param y0 Start Y-coord
- * @param x1 End X-coord
- * @param y1 End Y-coord
- * @param color 16-bit RGB565 color
+ * @brief Count the TE pulse of the first device (not the selected one).
+ * See \c ST7735_te_isr_dev()
  */
-void ST7735_draw_line(int16_t x0, int16_t y0,
-                      int16_t x1, int16_t y1,
-                      uint16_t color) {
-    tft_sel();
-    write_line(x0, y0, x1, y1, color);
-    tft_desel();
+void ST7735_te_isr(void) {
+    ST7735_te_isr_dev(tft_devs);
 }
 
 /*!
- * @brief Draw horizontal line
- * @param x Left x-coord
- * @param y Left y-coord
- * @param w Length (in pixels)
- * @param color 16-bit RGB565 color
+ * @brief Wait for the start of V-blanking period. Returns immediately,
+ * if TE is not enabled; gives up after \c TFT_TE_TIMEOUT ms.
  */
-void ST7735_draw_Hline(int16_t x, int16_t y, int16_t w, uint16_t color) {
-    if ((y >= TFT_HEIGHT) || (y < 0))
+void ST7735_wait_vsync(void) {
+    volatile uint8_t *pin;
+    uint8_t te_num = tft->spi_dev.intr.pin_num;
+    uint16_t timeout = TFT_TE_TIMEOUT * 100U;
+
+    if (!tft->spi_dev.intr.port)
+        return;
+    pin = tft->spi_dev.intr.port - 2;     // PINx register
+
+    if (tft->te_irq) {
+        uint8_t cnt = tft->te_cnt;
+
+        while ((cnt == tft->te_cnt) && --timeout)
+            _delay_us(10);
         return;
-    if (w < 0) {    // if right to left then revert
-        x += w;
-        w = -w;
-    }
-    if (x < 0) {
-        w += x;
-        x = 0;
     }
-    if ((x + w) >= TFT_WIDTH)
-        w = TFT_WIDTH - x;
 
-    tft_sel();
-    write_Hline(x, y, w, color);
-    tft_desel();
+    /* wait for the rising edge */
+    while (bit_is_set(*pin, te_num) && --timeout)
+        _delay_us(10);
+    while (!bit_is_set(*pin, te_num) && --timeout)
+        _delay_us(10);
 }
 
 /*!
- * @brief Draw vertical line
- * @param x Left x-coord
- * @param y Left y-coord
- * @param h Height (in pixels)
- * @param color 16-bit RGB565 color
+ * @brief Start the frame update. Waits for V-blanking and then
+ * \c TFT_TE_DELAY us, so the update starts from the top right behind
+ * the scan of display (or ahead of it with no delay).
  */
-void ST7735_draw_Vline(int16_t x, int16_t y, int16_t h, uint16_t color) {
-    if ((x >= TFT_WIDTH) || (x < 0))
-        return;
-    if (h < 0) {
-        y += h;
-        h = -h;
-    }
-    if (y < 0) {
-        h += y;
-        y = 0;
+void ST7735_frame_begin(void) {
+    ST7735_wait_vsync();
+#if TFT_TE_DELAY > 0
+    if (tft->spi_dev.intr.port)
+        _delay_us(TFT_TE_DELAY);
+#endif
+
+#ifdef TFT_TICKS
+    if (tft->te_irq && tft->stats.frames) {
+        /* vsyncs passed since previous frame without presentation */
+        uint8_t passed = tft->te_cnt - tft->frame_te;
+        if (passed > 1)
+            tft->stats.missed += passed - 1;
     }
-    if ((y + h) >= TFT_HEIGHT)
-        h = TFT_HEIGHT - y;
-    
-    tft_sel();
-    write_Vline(x, y, h, color);
-    tft_desel();
+    tft->frame_te = tft->te_cnt;
+    tft->frame_start = TFT_TICKS();
+#endif
 }
 
 /*!
- * @brief Draw a Circle. Bresenham's algorithm
- * @param x0 Center point, x coord
- * @param y0 Center point, y coord
- * @param radius Radius of circle
- * @param color 16-bit RGB565 draw color
+ * @brief End the frame update. Waits until all transfers are done
+ * and updates frame statistics (with \c TFT_TICKS()).
  */
-void ST7735_draw_circle_Bres(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
-    if (radius < 0)
-        radius = -radius;
-    int16_t x = 0;
-    int16_t y = radius;
-    int16_t delta = 1 - 2 * radius;
-    int16_t error;
-
-    tft_sel();
-
-    while (y >= 0) {
-        write_circle(x0, y0, x, y, color);
-
-        error = 2 * (delta + y) - 1;
-        if ((delta < 0) && (error <= 0)) {
-            delta += 2 * ++x;
-            continue;
-        }
-        if ((delta > 0) && (error > 0)) {
-            delta -= 2 * --y;
-            continue;
-        }
-        delta += 2 * (++x - --y);
-    }
+void ST7735_frame_end(void) {
+    tft_flush();
+
+#ifdef TFT_TICKS
+    tft->stats.frames++;
+    tft->stats.update_time = TFT_TICKS() - tft->frame_start;
+    if (tft->stats.update_time > tft->stats.max_update_time)
+        tft->stats.max_update_time = tft->stats.update_time;
+#endif
+}
 
-    tft_desel();
+#ifdef TFT_TICKS
+/*!
+ * @brief Get frame pacing statistics. Missed vsyncs are counted only
+ * if TE pulses are passed to \c ST7735_te_isr(); with polling of TE pin
+ * they are always 0.
+ * @return Pointer to statistics. Reset by \c ST7735_te_on()
+ */
+const tft_frame_stats *ST7735_frame_stats(void) {
+    return &tft->stats;
 }
+#endif
 
 /*!
- * @brief Draw a Circle. Michener's algorithm.
- * 15% faster than Bresenham's algorithm.
- * @param x0 Center point, x coord
- * @param y0 Center point, y coord
- * @param radius Radius of circle
- * @param color 16-bit RGB565 draw color
+ * @brief Set 12-bit color mode (4-4-4). Pixels are sent packed by pairs,
+ * so 25% less bytes are transferred than in 16-bit mode.
+ * Colors are still given in RGB565 and converted by driver.
+ * @param val \c true to set 12-bit mode; \c false to set 16-bit mode
  */
-void ST7735_draw_circle_Mich(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
-    if (radius < 0)
-        radius = -radius;
-    int16_t x = 0;
-    int16_t y = radius;
-    int16_t delta = 3 - 2 * radius;
+void ST7735_color_12bit(bool val) {
+    uint8_t data = val ? 0b011 : 0b101;
 
     tft_sel();
+    write_cmd_data(ST7735_COLMOD, &data, 1);
+    tft_desel();
 
-    while (x < y) {
-        write_circle(x0, y0, x, y, color);
-        write_circle(x0, y0, y, x, color);
+    tft->color12 = val;
+}
 
-        if (delta < 0)
-            delta += 4 * x++ + 6;
-        else
-            delta += 4 * (x++ - y--) + 10;
-    }
-    if (x == y)
-        write_circle(x0, y0, x, y, color);
+#ifndef TFT_ROTATION
+/*!
+ * @brief Set rotation of screen. Clipping bounds and text grid
+ * are changed to the new screen size, all viewports are closed.
+ * Screen content is not redrawn.
+ * @param rotation 0 - portrait, 1 - landscape (90 deg clockwise),
+ * 2 - portrait upside down, 3 - landscape (270 deg)
+ */
+void ST7735_set_rotation(uint8_t rotation) {
+    uint8_t data;
+
+    rotation &= 3;
+    data = rot_madctl(rotation);
 
+    tft_sel();
+    write_cmd_data(ST7735_MADCTL, &data, 1);
     tft_desel();
+
+    tft->rotation = rotation;
+    screen_upd();
 }
+#endif  /* TFT_ROTATION */
 
 /*!
- * @brief Draw a fill circle. Bresenham's algorithm
+ * @brief Get current rotation of screen
+ * @return Rotation [0:3]
+ */
+uint8_t ST7735_get_rotation(void) {
+    return TFT_ROT;
+}
+
+/*!
+ * @brief Get screen width in current rotation
+ * @return Width in pixels
+ */
+uint8_t ST7735_get_width(void) {
+    return TFT_W;
+}
+
+/*!
+ * @brief Get screen height in current rotation
+ * @return Height in pixels
+ */
+uint8_t ST7735_get_height(void) {
+    return TFT_H;
+}
+
+/*!
+ * @brief Turn on Partial mode. Only panel rows from \p y to \p y + \p h - 1
+ * are displayed. All drawing is clipped to them: to screen rows in portrait
+ * rotations and to screen columns in landscape.
+ * @param y First row of partial area (in portrait panel rows)
+ * @param h Height of partial area
+ * @param idle \c true to set IDLE mode too (8 colors, lowest power)
+ */
+void ST7735_partial_mode(uint8_t y, uint8_t h, bool idle) {
+    if ((y >= PANEL_H) || !h)
+        return;
+    if ((y + h) > PANEL_H)
+        h = PANEL_H - y;
+
+    uint8_t data[4] = {
+        0x00, PANEL_ROW_OFF + y,            /* Start row */
+        0x00, PANEL_ROW_OFF + y + h - 1     /* End row */
+    };
+
+    tft_sel();
+    write_cmd_data(ST7735_PTLAR, data, 4);
+    write_command(ST7735_PTLON);
+    tft_desel();
+
+    tft->ptl_y = y;
+    tft->ptl_h = h;
+    update_clip();
+
+    if (idle != tft->partial_idle) {
+        ST7735_idle_mode(idle);
+        tft->partial_idle = idle;
+    }
+}
+
+/*!
+ * @brief Turn off Partial mode and return to Normal mode.
+ * IDLE mode is turned off, if it was set by \c ST7735_partial_mode()
+ */
+void ST7735_normal_mode(void) {
+    tft_sel();
+    write_command(ST7735_NORON);
+    tft_desel();
+
+    tft->ptl_h = 0;
+    update_clip();
+
+    if (tft->partial_idle) {
+        ST7735_idle_mode(false);
+        tft->partial_idle = false;
+    }
+}
+
+/*!
+ * @brief Open a viewport. Following drawing uses coordinates relative
+ * to its top-left corner and is clipped by it. Viewport is clipped
+ * by the current clip rectangle, so nested widgets do not overdraw
+ * their neighbours. Text cursor in pixel mode is relative to it too.
+ * @param x X-corner of viewport (in current coordinates)
+ * @param y Y-corner of viewport (in current coordinates)
+ * @param w Width of viewport
+ * @param h Height of viewport
+ * @return \c false if \c TFT_CLIP_DEPTH viewports are already open
+ */
+bool ST7735_push_viewport(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (tft->view_cnt >= TFT_CLIP_DEPTH)
+        return false;
+
+    tft->views[tft->view_cnt++] = tft->view;
+    view_org(x, y);
+    rect_clip(&tft->view.clip, x, y, w, h);
+    tft->view.bounds = tft->view.clip;
+    tft->view.org_x = x;
+    tft->view.org_y = y;
+    update_clip();
+
+    return true;
+}
+
+/*!
+ * @brief Close the viewport opened by \c ST7735_push_viewport().
+ * Previous viewport and its clip rectangle are restored.
+ */
+void ST7735_pop_viewport(void) {
+    if (!tft->view_cnt)
+        return;
+
+    tft->view = tft->views[--tft->view_cnt];
+    update_clip();
+}
+
+/*!
+ * @brief Set clip rectangle inside the current viewport.
+ * All drawing is clipped by it once per primitive.
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ */
+void ST7735_set_clip(int16_t x, int16_t y, int16_t w, int16_t h) {
+    view_org(x, y);
+    tft->view.clip = tft->view.bounds;
+    rect_clip(&tft->view.clip, x, y, w, h);
+    update_clip();
+}
+
+/*!
+ * @brief Reset clip rectangle to the whole current viewport
+ */
+void ST7735_reset_clip(void) {
+    tft->view.clip = tft->view.bounds;
+    update_clip();
+}
+
+/*!
+ * @brief Fill the clip rectangle (the whole screen by default) with one color
+ * @param rgb565 16-bit 5-6-5 Color to fill
+ */
+void ST7735_fill_screen(uint16_t rgb565) {
+    uint8_t w = TFT_COL_MAX - TFT_COL_MIN;
+    uint8_t h = TFT_ROW_MAX - TFT_ROW_MIN;
+
+    if (!w || !h)
+        return;
+    if (dl_fill(TFT_COL_MIN, TFT_ROW_MIN, w, h, rgb565))
+        return;
+
+    tft_sel();
+
+    set_addr_window(TFT_COL_MIN, TFT_ROW_MIN, w, h);
+
+    write_color(rgb565, w * h);
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw the HSV-color palette
+ */
+void ST7735_draw_HSV(void) {
+    float hue = 0.0F;
+    float val;
+    float sat;
+    color_rgb rgb;
+
+    tft_sel();
+
+    set_addr_window(0, 0, TFT_W, TFT_H);
+
+    float step = 200.0F / TFT_W;
+
+    for (uint8_t y = 0; y < TFT_H; y++){
+        val = 100.0F;
+        sat = 0.0F;
+        for (uint8_t x = 0; x < (TFT_W / 2); x++) {
+            rgb = hsv_to_rgb((uint16_t)hue, (uint8_t)sat, (uint8_t)val);
+            write_px(color_565(rgb.red, rgb.green, rgb.blue));
+            sat += step;
+        }
+        sat = 100.0F;
+        for (uint8_t x = 0; x < (TFT_W / 2); x++) {
+            rgb = hsv_to_rgb((uint16_t)hue, (uint8_t)sat, (uint8_t)val);
+            write_px(color_565(rgb.red, rgb.green, rgb.blue));
+            val -= step;
+        }
+        hue += 360.0F / TFT_H;
+    }
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a single pixel to the display
+ * @param x X-coordinate to draw
+ * @param y Y-coordinate to draw
+ */
+void ST7735_draw_pixel(int16_t x, int16_t y, uint16_t color) {
+    view_org(x, y);
+    if ((x >= TFT_COL_MAX) || (x < TFT_COL_MIN) ||
+        (y >= TFT_ROW_MAX) || (y < TFT_ROW_MIN))
+        return;
+    if (dl_fill(x, y, 1, 1, color))
+        return;
+    
+    tft_sel();
+    write_pixel((uint8_t)x, (uint8_t)y, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Set address window of a batch. Only the changed range
+ * of columns or rows is sent.
+ * @param win Last window of the batch; zero width if not set yet
+ * @param x X-corner of window
+ * @param y Y-corner of window
+ * @param w Width of window
+ * @param h Height of window
+ */
+static void set_addr_window_cached(struct tft_rect *win, uint8_t x, uint8_t y,
+                                   uint8_t w, uint8_t h) {
+    uint8_t data[4];
+
+    px_flush();
+    if ((win->x0 != x) || (win->x1 != (uint8_t)(x + w))) {
+        win->x0 = x;
+        win->x1 = x + w;
+        data[0] = 0;
+        data[1] = x + TFT_X_OFF;
+        data[2] = 0;
+        data[3] = x + w - 1U + TFT_X_OFF;
+        write_cmd_data(ST7735_CASET, data, 4);
+    }
+    if ((win->y0 != y) || (win->y1 != (uint8_t)(y + h))) {
+        win->y0 = y;
+        win->y1 = y + h;
+        data[0] = 0;
+        data[1] = y + TFT_Y_OFF;
+        data[2] = 0;
+        data[3] = y + h - 1U + TFT_Y_OFF;
+        write_cmd_data(ST7735_RASET, data, 4);
+    }
+    write_command(ST7735_RAMWR);
+}
+
+/*!
+ * @brief Draw a batch of pixels. Points are sorted by rows in chunks
+ * of \c TFT_PIXELS_BUF, adjacent points of a row are sent as one run.
+ * @param pts Points
+ * @param colors Color of every point; NULL to use \p color
+ * @param n Number of points
+ * @param color 16-bit RGB565 color of all points
+ */
+static void draw_pixels(const tft_point *pts, const uint16_t *colors,
+                        uint16_t n, uint16_t color) {
+    uint16_t key[TFT_PIXELS_BUF];   // row and column of visible point
+    uint8_t idx[TFT_PIXELS_BUF];    // index of point in chunk
+    struct tft_rect win = {0, 0, 0, 0};
+
+    tft_sel();
+
+    for (uint16_t base = 0; base < n; base += TFT_PIXELS_BUF) {
+        uint8_t cnt = ((n - base) < TFT_PIXELS_BUF) ? (n - base) : TFT_PIXELS_BUF;
+        uint8_t m = 0;
+
+        /* clip and sort by rows, then by columns; order of duplicates is kept */
+        for (uint8_t i = 0; i < cnt; i++) {
+            int16_t x = pts[base + i].x + tft->view.org_x;
+            int16_t y = pts[base + i].y + tft->view.org_y;
+
+            if ((x < TFT_COL_MIN) || (x >= TFT_COL_MAX) ||
+                (y < TFT_ROW_MIN) || (y >= TFT_ROW_MAX))
+                continue;
+
+            uint16_t k = ((uint16_t)y << 8) | (uint8_t)x;
+            uint8_t j = m++;
+
+            for (; j && (key[j - 1] > k); j--) {
+                key[j] = key[j - 1];
+                idx[j] = idx[j - 1];
+            }
+            key[j] = k;
+            idx[j] = i;
+        }
+
+        for (uint8_t i = 0; i < m;) {
+            /* run of adjacent points */
+            uint8_t j = i + 1;
+            uint8_t len = 1;
+
+            for (; (j < m) && ((key[j] - key[j - 1]) <= 1); j++)
+                len += key[j] - key[j - 1];
+
+            uint8_t x = (uint8_t)key[i];
+            uint8_t y = key[i] >> 8;
+
+            if (!colors && dl_fill(x, y, len, 1, color)) {
+                i = j;
+                continue;
+            }
+            if (colors) {
+                for (; i < j; i++) {
+                    /* the last of duplicates is drawn */
+                    if (((i + 1) < j) && (key[i + 1] == key[i]))
+                        continue;
+                    uint16_t c = colors[base + idx[i]];
+
+                    if (dl_fill((uint8_t)key[i], y, 1, 1, c))
+                        continue;
+                    if (x == (uint8_t)key[i])
+                        set_addr_window_cached(&win, x, y, len, 1);
+                    write_px(c);
+                }
+            } else {
+                set_addr_window_cached(&win, x, y, len, 1);
+                write_color(color, len);
+                i = j;
+            }
+        }
+    }
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a batch of pixels of one color. Chip select is held for
+ * the whole batch; adjacent points of a row are merged into runs,
+ * and the window is resent only partially when its rows or columns
+ * are the same.
+ * @param pts Points
+ * @param n Number of points
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_pixels(const tft_point *pts, uint16_t n, uint16_t color) {
+    draw_pixels(pts, NULL, n, color);
+}
+
+/*!
+ * @brief Draw a batch of pixels of different colors,
+ * like \c ST7735_draw_pixels()
+ * @param pts Points
+ * @param colors 16-bit RGB565 color of every point
+ * @param n Number of points
+ */
+void ST7735_draw_pixels_colors(const tft_point *pts, const uint16_t *colors, uint16_t n) {
+    draw_pixels(pts, colors, n, 0);
+}
+
+/*!
+ * @brief Draw a line
+ * @param x0 Start X-coord
+ * @param y0 Start Y-coord
+ * @param x1 End X-coord
+ * @param y1 End Y-coord
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_line(int16_t x0, int16_t y0,
+                      int16_t x1, int16_t y1,
+                      uint16_t color) {
+    view_org(x0, y0);
+    view_org(x1, y1);
+    if (dl_shape(DL_LINE, color, 4, x0, y0, x1, y1))
+        return;
+
+    tft_sel();
+    write_line(x0, y0, x1, y1, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw horizontal line
+ * @param x Left x-coord
+ * @param y Left y-coord
+ * @param w Length (in pixels)
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_Hline(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    view_org(x, y);
+    if ((y >= TFT_ROW_MAX) || (y < TFT_ROW_MIN))
+        return;
+    if (w < 0) {    // if right to left then revert
+        x += w;
+        w = -w;
+    }
+    if (x < TFT_COL_MIN) {
+        w -= TFT_COL_MIN - x;
+        x = TFT_COL_MIN;
+    }
+    if ((x + w) >= TFT_COL_MAX)
+        w = TFT_COL_MAX - x;
+    if (w <= 0)
+        return;
+    if (dl_fill(x, y, w, 1, color))
+        return;
+
+    tft_sel();
+    write_Hline(x, y, w, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw vertical line
+ * @param x Left x-coord
+ * @param y Left y-coord
+ * @param h Height (in pixels)
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_Vline(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    view_org(x, y);
+    if ((x >= TFT_COL_MAX) || (x < TFT_COL_MIN))
+        return;
+    if (h < 0) {
+        y += h;
+        h = -h;
+    }
+    if (y < TFT_ROW_MIN) {
+        h -= TFT_ROW_MIN - y;
+        y = TFT_ROW_MIN;
+    }
+    if ((y + h) >= TFT_ROW_MAX)
+        h = TFT_ROW_MAX - y;
+    if (h <= 0)
+        return;
+    if (dl_fill(x, y, 1, h, color))
+        return;
+    
+    tft_sel();
+    write_Vline(x, y, h, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a Circle. Bresenham's algorithm
  * @param x0 Center point, x coord
  * @param y0 Center point, y coord
  * @param radius Radius of circle
  * @param color 16-bit RGB565 draw color
  */
-void ST7735_draw_fill_circle_Bres(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+void ST7735_draw_circle_Bres(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+    view_org(x0, y0);
+    if (dl_shape(DL_CIRCLE_B, color, 3, x0, y0, radius))
+        return;
     if (radius < 0)
         radius = -radius;
+    uint8_t clip = circle_clip(x0, y0, radius);
+    if (clip == 2)
+        return;
     int16_t x = 0;
     int16_t y = radius;
     int16_t delta = 1 - 2 * radius;
     int16_t error;
 
-    tft_sel();
+    tft_sel();
+
+    while (y >= 0) {
+        write_circle(x0, y0, x, y, color, clip);
+
+        error = 2 * (delta + y) - 1;
+        if ((delta < 0) && (error <= 0)) {
+            delta += 2 * ++x;
+            continue;
+        }
+        if ((delta > 0) && (error > 0)) {
+            delta -= 2 * --y;
+            continue;
+        }
+        delta += 2 * (++x - --y);
+    }
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a Circle. Michener's algorithm.
+ * 15% faster than Bresenham's algorithm.
+ * @param x0 Center point, x coord
+ * @param y0 Center point, y coord
+ * @param radius Radius of circle
+ * @param color 16-bit RGB565 draw color
+ */
+void ST7735_draw_circle_Mich(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+    view_org(x0, y0);
+    if (dl_shape(DL_CIRCLE_M, color, 3, x0, y0, radius))
+        return;
+    if (radius < 0)
+        radius = -radius;
+    uint8_t clip = circle_clip(x0, y0, radius);
+    if (clip == 2)
+        return;
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t delta = 3 - 2 * radius;
+
+    tft_sel();
+
+    while (x < y) {
+        write_circle(x0, y0, x, y, color, clip);
+        write_circle(x0, y0, y, x, color, clip);
+
+        if (delta < 0)
+            delta += 4 * x++ + 6;
+        else
+            delta += 4 * (x++ - y--) + 10;
+    }
+    if (x == y)
+        write_circle(x0, y0, x, y, color, clip);
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a fill circle. Bresenham's algorithm
+ * @param x0 Center point, x coord
+ * @param y0 Center point, y coord
+ * @param radius Radius of circle
+ * @param color 16-bit RGB565 draw color
+ */
+void ST7735_draw_fill_circle_Bres(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+    view_org(x0, y0);
+    if (dl_shape(DL_FILL_CIRCLE_B, color, 3, x0, y0, radius))
+        return;
+    if (radius < 0)
+        radius = -radius;
+    if (circle_clip(x0, y0, radius) == 2)
+        return;
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t delta = 1 - 2 * radius;
+    int16_t error;
+
+    tft_sel();
+
+    while (y >= 0) {
+        write_fill_circle(x0, y0, x, y, color);
+
+        error = 2 * (delta + y) - 1;
+        if ((delta < 0) && (error <= 0)) {
+            delta += 2 * ++x;
+            continue;
+        }
+        if ((delta > 0) && (error > 0)) {
+            delta -= 2 * --y;
+            continue;
+        }
+        delta += 2 * (++x - --y);
+    }
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a fill circle. Michener's algorithm.
+ * 15% faster than Bresenham's algorithm.
+ * @param x0 Center point, x coord
+ * @param y0 Center point, y coord
+ * @param radius Radius of circle
+ * @param color 16-bit RGB565 draw color
+ */
+void ST7735_draw_fill_circle_Mich(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+    view_org(x0, y0);
+    if (dl_shape(DL_FILL_CIRCLE_M, color, 3, x0, y0, radius))
+        return;
+    if (radius < 0)
+        radius = -radius;
+    if (circle_clip(x0, y0, radius) == 2)
+        return;
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t delta = 3 - 2 * radius;
+
+    tft_sel();
+
+    while (x < y) {
+        write_fill_circle(x0, y0, x, y, color);
+        write_fill_circle(x0, y0, y, x, color);
+
+        if (delta < 0)
+            delta += 4 * x++ + 6;
+        else
+            delta += 4 * (x++ - y--) + 10;
+    }
+    if (x == y)
+        write_fill_circle(x0, y0, x, y, color);
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a rectangle
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    view_org(x, y);
+    if (dl_shape(DL_RECT, color, 4, x, y, w, h))
+        return;
+    if (w < 0) {
+        x += w;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h;
+        h = -h;
+    }
+
+    int16_t x_temp = x;
+    int16_t y_temp = y + h - 1;
+    int16_t w_temp = w;
+    int16_t h_temp = h;
+
+    if (x < TFT_COL_MIN) {
+        w_temp -= TFT_COL_MIN - x;
+        x_temp = TFT_COL_MIN;
+    }
+    if ((x_temp + w_temp) >= TFT_COL_MAX)
+        w_temp = TFT_COL_MAX - x_temp;
+
+    tft_sel();
+
+    if (w_temp > 0) {
+        if ((y < TFT_ROW_MAX) && (y >= TFT_ROW_MIN))
+            write_Hline(x_temp, y, w_temp, color);
+        if ((y_temp < TFT_ROW_MAX) && (y_temp >= TFT_ROW_MIN))
+            write_Hline(x_temp, y_temp, w_temp, color);
+    }
+    
+    x_temp = x + w - 1;
+    y_temp = y;
+
+    if (y < TFT_ROW_MIN) {
+        h_temp -= TFT_ROW_MIN - y;
+        y_temp = TFT_ROW_MIN;
+    }
+    if ((y_temp + h_temp) >= TFT_ROW_MAX)
+        h_temp = TFT_ROW_MAX - y_temp;
+    
+    if (h_temp > 0) {
+        if ((x < TFT_COL_MAX) && (x >= TFT_COL_MIN))
+            write_Vline(x, y_temp, h_temp, color);
+        if ((x_temp < TFT_COL_MAX) && (x_temp >= TFT_COL_MIN))
+            write_Vline(x_temp, y_temp, h_temp, color);
+    }
+
+    tft_desel();
+}
+
+/*!
+ * @brief Fill a rectangle in screen coordinates with clipping
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param color 16-bit RGB565 color
+ */
+static void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w < 0) {
+        x += w;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h;
+        h = -h;
+    }
+    if (x < TFT_COL_MIN) {
+        w -= TFT_COL_MIN - x;
+        x = TFT_COL_MIN;
+    }
+    if (y < TFT_ROW_MIN) {
+        h -= TFT_ROW_MIN - y;
+        y = TFT_ROW_MIN;
+    }
+    if ((x >= TFT_COL_MAX) || (y >= TFT_ROW_MAX) || (w <= 0) || (h <= 0))
+        return;
+    if ((x + w) >= TFT_COL_MAX)
+        w = TFT_COL_MAX - x;
+    if ((y + h) >= TFT_ROW_MAX)
+        h = TFT_ROW_MAX - y;
+    if (dl_fill(x, y, w, h, color))
+        return;
+    
+    tft_sel();
+    set_addr_window(x, y, w, h);
+    write_color(color, w * h);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a fill rectangle
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_fill_rect(int16_t x, int16_t y,
+                           int16_t w, int16_t h, uint16_t color) {
+    view_org(x, y);
+    fill_rect(x, y, w, h, color);
+}
+
+/*!
+ * @brief Draw a single pixel without checks
+ * @param x X-coordinate on the screen, inside the clip rectangle
+ * @param y Y-coordinate on the screen, inside the clip rectangle
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_pixel_unchecked(uint8_t x, uint8_t y, uint16_t color) {
+    tft_assert(in_clip(x, y, 1, 1));
+    if (dl_fill(x, y, 1, 1, color))
+        return;
+
+    tft_sel();
+    write_pixel(x, y, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw horizontal line without checks
+ * @param x Left x-coord on the screen
+ * @param y Y-coord on the screen
+ * @param w Length (in pixels); the line must be inside the clip rectangle
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_Hline_unchecked(uint8_t x, uint8_t y, uint8_t w, uint16_t color) {
+    tft_assert(in_clip(x, y, w, 1));
+    if (dl_fill(x, y, w, 1, color))
+        return;
+
+    tft_sel();
+    write_Hline(x, y, w, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw vertical line without checks
+ * @param x X-coord on the screen
+ * @param y Top y-coord on the screen
+ * @param h Height (in pixels); the line must be inside the clip rectangle
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_Vline_unchecked(uint8_t x, uint8_t y, uint8_t h, uint16_t color) {
+    tft_assert(in_clip(x, y, 1, h));
+    if (dl_fill(x, y, 1, h, color))
+        return;
+
+    tft_sel();
+    write_Vline(x, y, h, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a rectangle without checks. All four sides are sent
+ * in one selection.
+ * @param x X-corner on the screen
+ * @param y Y-corner on the screen
+ * @param w Width; the rectangle must be inside the clip rectangle
+ * @param h Height
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_rect_unchecked(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint16_t color) {
+    tft_assert(in_clip(x, y, w, h));
+    if (dl_shape(DL_RECT, color, 4, x, y, w, h))
+        return;
+
+    tft_sel();
+    write_Hline(x, y, w, color);
+    write_Hline(x, y + h - 1, w, color);
+    write_Vline(x, y, h, color);
+    write_Vline(x + w - 1, y, h, color);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a fill rectangle without checks
+ * @param x X-corner on the screen
+ * @param y Y-corner on the screen
+ * @param w Width; the rectangle must be inside the clip rectangle
+ * @param h Height
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_fill_rect_unchecked(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint16_t color) {
+    tft_assert(in_clip(x, y, w, h));
+    if (dl_fill(x, y, w, h, color))
+        return;
+
+    tft_sel();
+    set_addr_window(x, y, w, h);
+    write_color(color, (uint16_t)w * h);
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a triangle
+ * @param x0 Vertex #0 X coord
+ * @param y0 Vertex #0 Y coord
+ * @param x1 Vertex #1 X coord
+ * @param y1 Vertex #1 Y coord
+ * @param x2 Vertex #2 X coord
+ * @param y2 Vertex #2 Y coord
+ * @param color 16-bit RGB565 color
+ */
+void ST7735_draw_triangle(int16_t x0, int16_t y0,
+                          int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+    view_org(x0, y0);
+    view_org(x1, y1);
+    view_org(x2, y2);
+    if (dl_shape(DL_TRIANGLE, color, 6, x0, y0, x1, y1, x2, y2))
+        return;
+
+    tft_sel();
+
+    write_line(x0, y0, x1, y1, color);
+    write_line(x1, y1, x2, y2, color);
+    write_line(x2, y2, x0, y0, color);
+
+    tft_desel();
+}
+
+/*!
+ * @brief Draw a filled triangle. Using Standard algorithm
+ * (http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html)
+ * (http://www-users.mat.uni.torun.pl/~wrona/3d_tutor/tri_fillers.html)
+ * @param a_x Vertex #A X coord
+ * @param a_y Vertex #A Y coord
+ * @param b_x Vertex #B X coord
+ * @param b_y Vertex #B Y coord
+ * @param c_x Vertex #C X coord
+ * @param c_y Vertex #C Y coord
+ * @param color 16-bit RGB565 color to fill
+ */
+void ST7735_draw_fill_triangle(int16_t a_x, int16_t a_y,
+                               int16_t b_x, int16_t b_y,
+                               int16_t c_x, int16_t c_y, uint16_t color) {
+    int16_t dx_c, dx_b, dx_a, dy_c, dy_b, dy_a;
+    int32_t d_s, d_e;   // delta for start/end drawing line
+    int16_t ls_x, l_y, le_x;    // coordinates for drawing line
+    int16_t y_end;
+
+    view_org(a_x, a_y);
+    view_org(b_x, b_y);
+    view_org(c_x, c_y);
+    if (dl_shape(DL_FILL_TRIANGLE, color, 6, a_x, a_y, b_x, b_y, c_x, c_y))
+        return;
+    
+    /* sort coordinates by order (a_y <= b_y <= c_y) */
+    if (a_y > b_y) {
+        swap_int16(&a_y, &b_y);
+        swap_int16(&a_x, &b_x);
+    }
+    if (b_y > c_y) {
+        swap_int16(&b_y, &c_y);
+        swap_int16(&b_x, &c_x);
+    }
+    if (a_y > b_y) {
+        swap_int16(&a_y, &b_y);
+        swap_int16(&a_x, &b_x);
+    }
+
+    /* clip once: rows of the clip rectangle are stepped only */
+    if ((c_y < TFT_ROW_MIN) || (a_y >= TFT_ROW_MAX))
+        return;
+    ls_x = le_x = a_x;
+    if (b_x < ls_x)
+        ls_x = b_x;
+    else if (b_x > le_x)
+        le_x = b_x;
+    if (c_x < ls_x)
+        ls_x = c_x;
+    else if (c_x > le_x)
+        le_x = c_x;
+    if ((le_x < TFT_COL_MIN) || (ls_x >= TFT_COL_MAX))
+        return;
+
+    tft_sel();
+
+    /* if triangle - horizontal line */
+    if (a_y == c_y) {
+        write_span(ls_x, le_x, a_y, color);
+        tft_desel();
+        return;
+    }
+
+    /* if triangle - vertical line */
+    if ((a_x == b_x) && (a_x == c_x)) {
+        if (a_y < TFT_ROW_MIN)
+            a_y = TFT_ROW_MIN;
+        if (c_y >= TFT_ROW_MAX)
+            c_y = TFT_ROW_MAX - 1;
+        write_Vline(a_x, a_y, c_y - a_y + 1, color);
+        tft_desel();
+        return;
+    }
+
+    dx_c = b_x - a_x;
+    dy_c = b_y - a_y;
+    dx_b = c_x - a_x;
+    dy_b = c_y - a_y;
+    dx_a = c_x - b_x;
+    dy_a = c_y - b_y;
+
+    /* upper part of triangle */
+    l_y = (a_y < TFT_ROW_MIN) ? TFT_ROW_MIN : a_y;
+    y_end = (b_y < TFT_ROW_MAX) ? b_y : TFT_ROW_MAX;
+    d_s = (int32_t)dx_c * (l_y - a_y);
+    d_e = (int32_t)dx_b * (l_y - a_y);
+    for (; l_y < y_end; l_y++) {
+        ls_x = a_x + (uint16_t)lround((double)((float)d_s / (float)dy_c));
+        le_x = a_x + (uint16_t)lround((double)((float)d_e / (float)dy_b));
+        d_s += dx_c;
+        d_e += dx_b;
+        write_span(ls_x, le_x, l_y, color);
+    }
+
+    /* lower part of triangle */
+    l_y = (b_y < TFT_ROW_MIN) ? TFT_ROW_MIN : b_y;
+    y_end = (c_y < TFT_ROW_MAX) ? c_y : (TFT_ROW_MAX - 1);
+    /* division by 0 protection */
+    if (dy_a) {
+        d_s = (int32_t)dx_a * (l_y - b_y);
+        d_e = (int32_t)dx_b * (l_y - a_y);
+        for (; l_y <= y_end; l_y++) {
+            ls_x = b_x + (uint16_t)lround((double)((float)d_s / (float)dy_a));
+            le_x = a_x + (uint16_t)lround((double)((float)d_e / (float)dy_b));
+            d_s += dx_a;
+            d_e += dx_b;
+            write_span(ls_x, le_x, l_y, color);
+        }
+    } else if (l_y == b_y) {
+        write_span(b_x, c_x, b_y, color);
+    }
+
+    tft_desel();
+}
+
+/* Polygon edge (16.16 fixed point x, in polygon coordinates) */
+struct poly_edge {
+    int32_t x;      // x at the center of current row
+    int32_t dx;     // x step per row
+    int16_t y_min;  // first row on screen
+    int16_t y_max;  // last row on screen + 1
+    int8_t dir;     // winding direction: 1 - down, -1 - up
+};
+
+/*!
+ * @brief Draw a filled polygon. Simple, concave and self-intersecting
+ * polygons are filled by scanlines with an active edge table;
+ * every span is sent once. Pixels are filled if their centers are inside,
+ * so adjacent polygons with shared edges do not overlap.
+ * @param pts Vertices; the polygon is closed automatically
+ * @param n Number of vertices [3:TFT_POLY_MAX]
+ * @param color 16-bit RGB565 color to fill
+ * @param nonzero \c true - non-zero winding rule; \c false - even-odd rule
+ */
+void ST7735_draw_fill_polygon(const tft_point *pts, uint8_t n, uint16_t color, bool nonzero) {
+    struct poly_edge edges[TFT_POLY_MAX];
+    uint8_t active[TFT_POLY_MAX];
+    uint8_t ne = 0, na = 0, next = 0;
+    int16_t y, y_end;
+
+    if ((n < 3) || (n > TFT_POLY_MAX))
+        return;
+
+    /* edge table sorted by first row; horizontal edges and edges
+     * out of the clip rows are skipped
+     */
+    for (uint8_t i = 0; i < n; i++) {
+        const tft_point *p0 = &pts[i];
+        const tft_point *p1 = &pts[(i + 1 < n) ? (i + 1) : 0];
+        struct poly_edge e;
+
+        if (p0->y == p1->y)
+            continue;
+        e.dir = 1;
+        if (p0->y > p1->y) {
+            const tft_point *t = p0;
+            p0 = p1;
+            p1 = t;
+            e.dir = -1;
+        }
+
+        /* rows of edge on screen; coordinates span up to 16 bits */
+        int32_t y0 = (int32_t)p0->y + tft->view.org_y;
+        int32_t y1 = (int32_t)p1->y + tft->view.org_y;
+        if ((y1 <= TFT_ROW_MIN) || (y0 >= TFT_ROW_MAX))
+            continue;
+        e.y_min = (y0 > TFT_ROW_MIN) ? y0 : TFT_ROW_MIN;
+        e.y_max = (y1 < TFT_ROW_MAX) ? y1 : TFT_ROW_MAX;
+
+        /* slope and x at the center of the first row on screen by parts,
+         * as products do not fit in 32 bits. Only the sum is in range,
+         * so it is accumulated modulo 2^32.
+         */
+        uint16_t dy = (int32_t)p1->y - p0->y;
+        int32_t dx = (int32_t)p1->x - p0->x;
+        uint16_t adx = (dx < 0) ? -dx : dx;
+        uint32_t k = (uint32_t)adx * (uint16_t)(e.y_min - y0);
+        uint32_t off = ((k / dy) << 16) + ((k % dy) << 16) / dy + ((uint32_t)adx << 15) / dy;
+        uint32_t step = (dy > 1) ? (((uint32_t)(adx / dy) << 16) +
+                                    ((uint32_t)(adx % dy) << 16) / dy) : 0;
+
+        e.dx = (dx < 0) ? -(int32_t)step : (int32_t)step;
+        e.x = (int32_t)(((uint32_t)(int32_t)p0->x << 16) + ((dx < 0) ? -off : off));
+
+        uint8_t j = ne++;
+        for (; j && (edges[j - 1].y_min > e.y_min); j--)
+            edges[j] = edges[j - 1];
+        edges[j] = e;
+    }
+    if (!ne)
+        return;
+
+    y = edges[0].y_min;
+    y_end = y;
+    for (uint8_t i = 0; i < ne; i++) {
+        if (edges[i].y_max > y_end)
+            y_end = edges[i].y_max;
+    }
+
+    tft_sel();
+
+    for (; y < y_end; y++) {
+        /* update active edges */
+        while ((next < ne) && (edges[next].y_min <= y))
+            active[na++] = next++;
+        for (uint8_t i = 0; i < na;) {
+            if (edges[active[i]].y_max <= y)
+                active[i] = active[--na];
+            else
+                i++;
+        }
+        /* sort by x (insertion; order changes only at crossings) */
+        for (uint8_t i = 1; i < na; i++) {
+            uint8_t a = active[i];
+            uint8_t j = i;
+            for (; j && (edges[active[j - 1]].x > edges[a].x); j--)
+                active[j] = active[j - 1];
+            active[j] = a;
+        }
+
+        /* spans between crossings */
+        int8_t wind = 0;
+        for (uint8_t i = 0; i + 1 < na; i++) {
+            struct poly_edge *e = &edges[active[i]];
 
-    while (y >= 0) {
-        write_fill_circle(x0, y0, x, y, color);
+            wind = nonzero ? (wind + e->dir) : (wind ^ 1);
+            if (!wind)
+                continue;
 
-        error = 2 * (delta + y) - 1;
-        if ((delta < 0) && (error <= 0)) {
-            delta += 2 * ++x;
-            continue;
-        }
-        if ((delta > 0) && (error > 0)) {
-            delta -= 2 * --y;
-            continue;
+            int32_t xs = ((e->x + 0x7FFF) >> 16) + tft->view.org_x;
+            int32_t xe = ((edges[active[i + 1]].x + 0x7FFF) >> 16) + tft->view.org_x;
+
+            if (xs < TFT_COL_MIN)
+                xs = TFT_COL_MIN;
+            if (xe > TFT_COL_MAX)
+                xe = TFT_COL_MAX;
+            if (xs >= xe)
+                continue;
+            if (!dl_fill(xs, y, xe - xs, 1, color))
+                write_Hline(xs, y, xe - xs, color);
         }
-        delta += 2 * (++x - --y);
+
+        for (uint8_t i = 0; i < na; i++)
+            edges[active[i]].x += edges[active[i]].dx;
     }
 
     tft_desel();
 }
 
 /*!
- * @brief Draw a fill circle. Michener's algorithm.
- * 15% faster than Bresenham's algorithm.
- * @param x0 Center point, x coord
- * @param y0 Center point, y coord
- * @param radius Radius of circle
- * @param color 16-bit RGB565 draw color
+ * @brief Read a rectangle of pixels in screen coordinates
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param buf Buffer for \p w * \p h RGB565 colors (row by row)
+ * @return \c false if rectangle is not entirely on the screen
  */
-void ST7735_draw_fill_circle_Mich(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
-    if (radius < 0)
-        radius = -radius;
-    int16_t x = 0;
-    int16_t y = radius;
-    int16_t delta = 3 - 2 * radius;
-
-    tft_sel();
+static bool read_rect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint16_t *buf) {
+    if ((x < 0) || (y < 0) || !w || !h ||
+        ((x + w) > TFT_W) || ((y + h) > TFT_H))
+        return false;
+
+    tft_flush();
+    tft_cs_sel();
+    read_window(x, y, w, h);
+    for (uint16_t i = w * h; i; i--)
+        *buf++ = read_px();
+    tft_cs_desel();
+    read_end();
+
+    return true;
+}
 
-    while (x < y) {
-        write_fill_circle(x0, y0, x, y, color);
-        write_fill_circle(x0, y0, y, x, color);
+/*!
+ * @brief Read a rectangle of pixels from display memory.
+ * SPI is switched to read speed once for the whole rectangle.
+ * Reading is not limited by the clip rectangle.
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param buf Buffer for \p w * \p h RGB565 colors (row by row)
+ * @return \c false if rectangle is not entirely on the screen
+ */
+bool ST7735_read_rect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint16_t *buf) {
+    view_org(x, y);
+    return read_rect(x, y, w, h, buf);
+}
 
-        if (delta < 0)
-            delta += 4 * x++ + 6;
-        else
-            delta += 4 * (x++ - y--) + 10;
-    }
-    if (x == y)
-        write_fill_circle(x0, y0, x, y, color);
+/*!
+ * @brief Read a single pixel from display memory
+ * @param x X-coordinate
+ * @param y Y-coordinate
+ * @return 16-bit RGB565 color; 0 if pixel is outside the screen
+ */
+uint16_t ST7735_read_pixel(int16_t x, int16_t y) {
+    uint16_t color = 0;
 
-    tft_desel();
+    ST7735_read_rect(x, y, 1, 1, &color);
+    return color;
 }
 
 /*!
- * @brief Draw a rectangle
- * @param x X-corner of rectangle
- * @param y Y-corner of rectangle
+ * @brief Copy a rectangle of display memory to another place.
+ * Pixels are read back by chunks of \c TFT_COPY_BUF pixels and written
+ * to destination. Overlapped rectangles are copied in a safe order.
+ * Source is clipped by the screen, destination - by the clip rectangle.
+ * @param src_x X-corner of source rectangle
+ * @param src_y Y-corner of source rectangle
  * @param w Width of rectangle
  * @param h Height of rectangle
- * @param color 16-bit RGB565 color
+ * @param dst_x X-corner of destination rectangle
+ * @param dst_y Y-corner of destination rectangle
  */
-void ST7735_draw_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
-    if (w < 0) {
-        x += w;
-        w = -w;
+void ST7735_copy_rect(int16_t src_x, int16_t src_y, int16_t w, int16_t h,
+                      int16_t dst_x, int16_t dst_y) {
+    uint16_t buf[TFT_COPY_BUF];
+    int16_t d;
+
+    view_org(src_x, src_y);
+    view_org(dst_x, dst_y);
+
+    /* clip both rectangles */
+    d = (-src_x > (TFT_COL_MIN - dst_x)) ? -src_x : (TFT_COL_MIN - dst_x);
+    if (d > 0) {
+        src_x += d;
+        dst_x += d;
+        w -= d;
     }
-    if (h < 0) {
-        y += h;
-        h = -h;
+    d = (src_y < dst_y - TFT_ROW_MIN) ? -src_y : (TFT_ROW_MIN - dst_y);
+    if (d > 0) {
+        src_y += d;
+        dst_y += d;
+        h -= d;
     }
+    if ((src_x + w) > TFT_W)
+        w = TFT_W - src_x;
+    if ((dst_x + w) > TFT_COL_MAX)
+        w = TFT_COL_MAX - dst_x;
+    if ((src_y + h) > TFT_H)
+        h = TFT_H - src_y;
+    if ((dst_y + h) > TFT_ROW_MAX)
+        h = TFT_ROW_MAX - dst_y;
+    if ((w <= 0) || (h <= 0) || ((src_x == dst_x) && (src_y == dst_y)))
+        return;
 
-    int16_t x_temp = x;
-    int16_t y_temp = y + h - 1;
-    int16_t w_temp = w;
-    int16_t h_temp = h;
+    /* moving down - copy from the bottom, moving right - from the right */
+    bool from_bottom = dst_y > src_y;
+    bool from_right = (dst_y == src_y) && (dst_x > src_x);
+    uint8_t seg_w = (w > TFT_COPY_BUF) ? TFT_COPY_BUF : w;
+    uint8_t seg_h = (w > TFT_COPY_BUF) ? 1 : (TFT_COPY_BUF / w);
 
-    if (x < 0) {
-        w_temp += x;
-        x_temp = 0;
-    }
-    if ((x_temp + w_temp) >= TFT_WIDTH)
-        w_temp = TFT_WIDTH - x_temp;
+    for (int16_t i = 0; i < h; i += seg_h) {
+        uint8_t n = ((h - i) < seg_h) ? (h - i) : seg_h;
+        int16_t row = from_bottom ? (h - i - n) : i;
 
-    tft_sel();
+        for (int16_t j = 0; j < w; j += seg_w) {
+            uint8_t m = ((w - j) < seg_w) ? (w - j) : seg_w;
+            int16_t col = from_right ? (w - j - m) : j;
 
-    if ((y < TFT_HEIGHT) && (y >= 0))
-        write_Hline(x_temp, y, w_temp, color);
-    if ((y_temp < TFT_HEIGHT) && (y_temp >= 0))
-        write_Hline(x_temp, y_temp, w_temp, color);
-    
-    x_temp = x + w - 1;
-    y_temp = y;
+            read_rect(src_x + col, src_y + row, m, n, buf);
 
-    if (y < 0) {
-        h_temp += y;
-        y_temp = 0;
+            tft_sel();
+            set_addr_window(dst_x + col, dst_y + row, m, n);
+            for (uint16_t k = 0; k < m * n; k++)
+                write_px(buf[k]);
+            tft_desel();
+        }
     }
-    if ((y_temp + h_temp) >= TFT_HEIGHT)
-        h_temp = TFT_HEIGHT - y_temp;
-    
-    if ((x < TFT_WIDTH) && (x >= 0))
-        write_Vline(x, y_temp, h_temp, color);
-    if ((x_temp < TFT_WIDTH) && (x_temp >= 0))
-        write_Vline(x_temp, y_temp, h_temp, color);
+}
+
+/*!
+ * @brief Blend a span of pixels with color over the display memory.
+ * @param x Start X-coord
+ * @param y Y-coord
+ * @param n Length of span [1:TFT_COPY_BUF]
+ * @param color 16-bit RGB565 color
+ * @param alpha Opacity of every pixel [0:32]; NULL to use \p a
+ * @param a Opacity of all pixels [0:32]
+ */
+static void blend_span(uint8_t x, uint8_t y, uint8_t n, uint16_t color,
+                       const uint8_t *alpha, uint8_t a) {
+    uint16_t buf[TFT_COPY_BUF];
+
+    read_rect(x, y, n, 1, buf);
 
+    tft_sel();
+    set_addr_window(x, y, n, 1);
+    for (uint8_t i = 0; i < n; i++) {
+        if (alpha)
+            a = alpha[i];
+        write_px(color_blend_565(color, buf[i], a));
+    }
     tft_desel();
 }
 
 /*!
- * @brief Draw a fill rectangle
+ * @brief Draw a semi-transparent fill rectangle. Background is read back
+ * from display memory, so MISO must be connected.
  * @param x X-corner of rectangle
  * @param y Y-corner of rectangle
  * @param w Width of rectangle
  * @param h Height of rectangle
  * @param color 16-bit RGB565 color
+ * @param alpha Opacity [0:255]
  */
-void ST7735_draw_fill_rect(int16_t x, int16_t y,
-                           int16_t w, int16_t h, uint16_t color) {
+void ST7735_blend_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color, uint8_t alpha) {
+    uint8_t a = (alpha + 4U) >> 3;
+
+    view_org(x, y);
+    if (a == 32) {
+        fill_rect(x, y, w, h, color);
+        return;
+    }
     if (w < 0) {
         x += w;
         w = -w;
@@ -832,205 +3108,744 @@ void ST7735_draw_fill_rect(int16_t x, int16_t y,
         y += h;
         h = -h;
     }
-    if (x < 0) {
-        w += x;
-        x = 0;
+    if (x < TFT_COL_MIN) {
+        w -= TFT_COL_MIN - x;
+        x = TFT_COL_MIN;
     }
-    if (y < 0) {
-        h += y;
-        y = 0;
+    if (y < TFT_ROW_MIN) {
+        h -= TFT_ROW_MIN - y;
+        y = TFT_ROW_MIN;
     }
-    if ((x >= TFT_WIDTH) || (y >= TFT_HEIGHT) || ((x + w) < 0) || ((y + h) < 0))
+    if ((x + w) > TFT_COL_MAX)
+        w = TFT_COL_MAX - x;
+    if ((y + h) > TFT_ROW_MAX)
+        h = TFT_ROW_MAX - y;
+    if (!a || (w <= 0) || (h <= 0))
         return;
-    if ((x + w) >= TFT_WIDTH)
-        w = TFT_WIDTH - x;
-    if ((y + h) >= TFT_HEIGHT)
-        h = TFT_HEIGHT - y;
-    
-    tft_sel();
-    set_addr_window(x, y, w, h);
-    for (uint16_t i = 0; i < w * h; i++)
-        spi_write16(color);
-    tft_desel();
+
+    for (; h; h--, y++) {
+        for (int16_t i = 0; i < w; i += TFT_COPY_BUF) {
+            uint8_t n = ((w - i) < TFT_COPY_BUF) ? (w - i) : TFT_COPY_BUF;
+            blend_span(x + i, y, n, color, NULL, a);
+        }
+    }
 }
 
+/* Opacity [0:32] of 2-bit and 4-bit alpha */
+static const uint8_t alpha2_32[4] PROGMEM = {0, 11, 21, 32};
+static const uint8_t alpha4_32[16] PROGMEM = {
+    0, 2, 4, 6, 9, 11, 13, 15, 17, 19, 21, 23, 26, 28, 30, 32
+};
+
 /*!
- * @brief Draw a triangle
- * @param x0 Vertex #0 X coord
- * @param y0 Vertex #0 Y coord
- * @param x1 Vertex #1 X coord
- * @param y1 Vertex #1 Y coord
- * @param x2 Vertex #2 X coord
- * @param y2 Vertex #2 Y coord
- * @param color 16-bit RGB565 color
+ * @brief Recalculate the blend table of text color over text background
+ * color. 2-bit alpha v is the 4-bit alpha v * 5.
  */
-void ST7735_draw_triangle(int16_t x0, int16_t y0,
-                          int16_t x1, int16_t y1,
-                          int16_t x2, int16_t y2, uint16_t color) {
-    tft_sel();
+static void text_lut_upd(void) {
+    for (uint8_t i = 0; i < 16; i++)
+        tft->text_lut[i] = color_blend_565(tft->tft_text_color, tft->tft_text_bg_color,
+                                           pgm_read_byte(&alpha4_32[i]));
+}
 
-    write_line(x0, y0, x1, y1, color);
-    write_line(x1, y1, x2, y2, color);
-    write_line(x2, y2, x0, y0, color);
+/*!
+ * @brief Draw an anti-aliased glyph in text color. If transparent text
+ * mode is on, glyph is blended over display memory (read back);
+ * else over text background color.
+ * @param x X-corner of glyph
+ * @param y Y-corner of glyph
+ * @param w Width of glyph
+ * @param h Height of glyph
+ * @param glyph PROGMEM alpha map, row by row, MSB first, no row padding
+ * @param bpp Bits per pixel of alpha: 2 or 4; nothing is drawn otherwise
+ */
+void ST7735_draw_glyph_aa(int16_t x, int16_t y, uint8_t w, uint8_t h,
+                          const uint8_t *glyph, uint8_t bpp) {
+    if ((bpp != 2) && (bpp != 4))
+        return;
 
-    tft_desel();
+    const uint8_t *lut = (bpp == 4) ? alpha4_32 : alpha2_32;
+    uint8_t mask = (1U << bpp) - 1;
+    uint8_t gx = 0, gy = 0;
+    int16_t vw = w, vh = h;
+
+    view_org(x, y);
+
+    /* visible part of glyph */
+    if (x < TFT_COL_MIN) {
+        gx = TFT_COL_MIN - x;
+        vw -= gx;
+        x = TFT_COL_MIN;
+    }
+    if (y < TFT_ROW_MIN) {
+        gy = TFT_ROW_MIN - y;
+        vh -= gy;
+        y = TFT_ROW_MIN;
+    }
+    if ((x + vw) > TFT_COL_MAX)
+        vw = TFT_COL_MAX - x;
+    if ((y + vh) > TFT_ROW_MAX)
+        vh = TFT_ROW_MAX - y;
+    if ((vw <= 0) || (vh <= 0))
+        return;
+
+    uint8_t alpha[TFT_COPY_BUF];
+    uint8_t step = 15 / mask;   // 4-bit index of alpha in text_lut
+    bool transp = tft->tft_flags & _BV(TFT_TRANSP_TEXT);
+
+    if (!transp) {
+        /* all colors of glyph are known */
+        tft_sel();
+        set_addr_window(x, y, vw, vh);
+    }
+
+    for (uint8_t row = 0; row < vh; row++) {
+        /* up to 255 * 255 * 4 bits */
+        uint32_t bit = ((uint32_t)(gy + row) * w + gx) * bpp;
+
+        for (uint16_t i = 0; i < vw; i += TFT_COPY_BUF) {
+            uint8_t n = ((vw - i) < TFT_COPY_BUF) ? (vw - i) : TFT_COPY_BUF;
+
+            for (uint8_t j = 0; j < n; j++, bit += bpp) {
+                uint8_t v = pgm_read_byte(&glyph[bit >> 3]);
+                v = (v >> (8 - bpp - (bit & 7))) & mask;
+                if (transp)
+                    alpha[j] = pgm_read_byte(&lut[v]);
+                else
+                    write_px(tft->text_lut[v * step]);
+            }
+            if (transp)
+                blend_span(x + i, y + row, n, tft->tft_text_color, alpha, 0);
+        }
+    }
+
+    if (!transp)
+        tft_desel();
 }
 
 /*!
- * @brief Draw a filled triangle. Using Standard algorithm
- * (http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html)
- * (http://www-users.mat.uni.torun.pl/~wrona/3d_tutor/tri_fillers.html)
- * @param a_x Vertex #A X coord
- * @param a_y Vertex #A Y coord
- * @param b_x Vertex #B X coord
- * @param b_y Vertex #B Y coord
- * @param c_x Vertex #C X coord
- * @param c_y Vertex #C Y coord
- * @param color 16-bit RGB565 color to fill
+ * @brief Integer square root
+ * @param v Value
+ * @return Floor of square root
  */
-void ST7735_draw_fill_triangle(int16_t a_x, int16_t a_y,
-                               int16_t b_x, int16_t b_y,
-                               int16_t c_x, int16_t c_y, uint16_t color) {
-    int16_t dx_c, dx_b, dx_a, dy_c, dy_b, dy_a;
-    int32_t d_s, d_e;   // delta for start/end drawing line
-    int16_t ls_x, l_y, le_x;    // coordinates for drawing line
-    
-    /* sort coordinates by order (a_y <= b_y <= c_y) */
-    if (a_y > b_y) {
-        swap_int16(&a_y, &b_y);
-        swap_int16(&a_x, &b_x);
+static uint8_t isqrt16(uint16_t v) {
+    uint16_t res = 0;
+    uint16_t bit = 1U << 14;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
     }
-    if (b_y > c_y) {
-        swap_int16(&b_y, &c_y);
-        swap_int16(&b_x, &c_x);
+    return res;
+}
+
+/*!
+ * @brief Integer square root of 32-bit value; 16-bit values take
+ * the faster \c isqrt16()
+ * @param v Value
+ * @return Floor of square root
+ */
+static uint16_t isqrt32(uint32_t v) {
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    if (v <= 0xFFFFU)
+        return isqrt16(v);
+    while (bit > v)
+        bit >>= 2;
+    while (bit) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
     }
-    if (a_y > b_y) {
-        swap_int16(&a_y, &b_y);
-        swap_int16(&a_x, &b_x);
+    return res;
+}
+
+/*!
+ * @brief Fill a span of scene row buffer
+ * @param row Row buffer of strip
+ * @param x0 First X-coord of span
+ * @param x1 Last X-coord of span + 1
+ * @param sx X-coord of strip
+ * @param sw Width of strip
+ * @param color 16-bit RGB565 color
+ */
+static void scene_span(uint16_t *row, int16_t x0, int16_t x1,
+                       int16_t sx, uint8_t sw, uint16_t color) {
+    if (x0 < sx)
+        x0 = sx;
+    if (x1 > (sx + sw))
+        x1 = sx + sw;
+    for (; x0 < x1; x0++)
+        row[x0 - sx] = color;
+}
+
+/*!
+ * @brief Paint part of shape on one row to scene row buffer
+ * @param sh Shape
+ * @param y Y-coord of row
+ * @param row Row buffer of strip
+ * @param sx X-coord of strip
+ * @param sw Width of strip
+ */
+static void scene_row(const tft_shape *sh, int16_t y, uint16_t *row,
+                      int16_t sx, uint8_t sw) {
+    int16_t dy = y - sh->y;
+
+    switch (sh->type) {
+        case TFT_SHAPE_FILL_RECT:
+            if ((dy >= 0) && (dy < sh->h))
+                scene_span(row, sh->x, sh->x + sh->w, sx, sw, sh->color);
+            break;
+        case TFT_SHAPE_RECT:
+            if ((dy < 0) || (dy >= sh->h))
+                break;
+            if (!dy || (dy == (sh->h - 1))) {
+                scene_span(row, sh->x, sh->x + sh->w, sx, sw, sh->color);
+            } else {
+                scene_span(row, sh->x, sh->x + 1, sx, sw, sh->color);
+                scene_span(row, sh->x + sh->w - 1, sh->x + sh->w, sx, sw, sh->color);
+            }
+            break;
+        case TFT_SHAPE_FILL_CIRCLE:
+            if ((dy < -sh->w) || (dy > sh->w))
+                break;
+            {
+                /* half of chord; + r to round like midpoint circle */
+                int16_t hw = isqrt32((int32_t)sh->w * sh->w - (int32_t)dy * dy + sh->w);
+                if (hw > sh->w)
+                    hw = sh->w;
+                scene_span(row, sh->x - hw, sh->x + hw + 1, sx, sw, sh->color);
+            }
+            break;
+        case TFT_SHAPE_TEXT:
+            if ((dy < 0) || (dy > FONT_5X7_HEIGHT))
+                break;
+            {
+                int16_t cx = sh->x;
+
+                for (const char *c = sh->text; *c; c++, cx += FONT_5X7_WIDTH + 1) {
+                    if (cx >= (sx + sw))
+                        break;
+                    if ((cx + FONT_5X7_WIDTH) < sx)
+                        continue;
+
+                    uint8_t bits = pgm_read_byte(&font5x7_cp437[(uint8_t)*c][dy]);
+                    for (uint8_t i = 0; bits; i++, bits >>= 1) {
+                        if ((bits & 1) && ((cx + i) >= sx) && ((cx + i) < (sx + sw)))
+                            row[cx + i - sx] = sh->color;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
     }
+}
 
-    tft_sel();
+/*!
+ * @brief Draw a scene of overlapping shapes. The rectangle is rendered
+ * row by row: the top-most color of every pixel is resolved in a row
+ * buffer, so every pixel is sent once through a single window.
+ * Rectangles wider than \c TFT_SCENE_BUF are drawn by strips.
+ * Circle edges may differ by a pixel from \c ST7735_draw_fill_circle_*.
+ * @param x X-corner of scene rectangle
+ * @param y Y-corner of scene rectangle
+ * @param w Width of scene rectangle
+ * @param h Height of scene rectangle
+ * @param bg Color of pixels not covered by shapes
+ * @param shapes Shapes from back to front
+ * @param n Number of shapes
+ */
+void ST7735_draw_scene(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t bg,
+                       const tft_shape *shapes, uint8_t n) {
+    uint16_t row[TFT_SCENE_BUF];
+    int16_t ox = tft->view.org_x;
+    int16_t oy = tft->view.org_y;
+
+    view_org(x, y);
+    if (x < TFT_COL_MIN) {
+        w -= TFT_COL_MIN - x;
+        x = TFT_COL_MIN;
+    }
+    if (y < TFT_ROW_MIN) {
+        h -= TFT_ROW_MIN - y;
+        y = TFT_ROW_MIN;
+    }
+    if ((x + w) > TFT_COL_MAX)
+        w = TFT_COL_MAX - x;
+    if ((y + h) > TFT_ROW_MAX)
+        h = TFT_ROW_MAX - y;
+    if ((w <= 0) || (h <= 0))
+        return;
 
-    /* if triangle - horizontal line */
-    if (a_y == c_y) {
-        if ((a_y < 0) || (a_y) >= TFT_HEIGHT) {
-            tft_desel();
-            return;
+    for (int16_t sx = x; sx < (x + w); sx += TFT_SCENE_BUF) {
+        uint8_t sw = ((x + w - sx) < TFT_SCENE_BUF) ? (x + w - sx) : TFT_SCENE_BUF;
+
+        tft_sel();
+        set_addr_window(sx, y, sw, h);
+        for (int16_t ry = y; ry < (y + h); ry++) {
+            for (uint8_t i = 0; i < sw; i++)
+                row[i] = bg;
+            for (uint8_t k = 0; k < n; k++)
+                scene_row(&shapes[k], ry - oy, row, sx - ox, sw);
+            for (uint8_t i = 0; i < sw; i++)
+                write_px(row[i]);
         }
-        /* sort x-coordinates from smallest to largest */
-        ls_x = le_x = a_x;
-        if (b_x < ls_x)
-            ls_x = b_x;
-        else if (b_x > le_x)
-            le_x = b_x;
-        if (c_x < ls_x)
-            ls_x = c_x;
-        else if (c_x > le_x)
-            le_x = c_x;
-        
-        if (ls_x < 0)
-            ls_x = 0;
-        if (le_x >= TFT_WIDTH)
-            le_x = TFT_WIDTH - 1;
-        write_Hline(ls_x, a_y, le_x - ls_x + 1, color);
         tft_desel();
+    }
+}
+
+/* Ordered dithering thresholds (4x4 Bayer matrix) */
+static const uint8_t bayer4[16] PROGMEM = {
+     0,  8,  2, 10,
+    12,  4, 14,  6,
+     3, 11,  1,  9,
+    15,  7, 13,  5
+};
+
+/*!
+ * @brief Fill a rectangle or a rounded rectangle with a gradient.
+ * Color channels are stepped in 8.8 fixed point; the rectangle is streamed
+ * in one window (a rounded one - plus a window per row of corners).
+ * @param x X-corner of rectangle
+ * @param y Y-corner of rectangle
+ * @param w Width of rectangle
+ * @param h Height of rectangle
+ * @param radius Radius of corners; 0 for sharp corners
+ * @param c0 Start color (left, top, top-left or center)
+ * @param c1 End color (right, bottom, bottom-right or corners)
+ * @param mode \c TFT_GRAD_H, \c TFT_GRAD_V, \c TFT_GRAD_D or \c TFT_GRAD_RADIAL,
+ * optionally with \c TFT_GRAD_DITHER for ordered dithering
+ */
+void ST7735_fill_gradient(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t radius,
+                          uint16_t c0, uint16_t c1, uint8_t mode) {
+    int16_t start[3], step[3];
+    bool dither = mode & TFT_GRAD_DITHER;
+    uint8_t kx = 0, ky = 0;     // steps of color along x and y (linear)
+    int16_t cx = w / 2, cy = h / 2;     // center (radial)
+    int16_t n, y0, y1;
+
+    view_org(x, y);
+    if ((w <= 0) || (h <= 0))
+        return;
+    if ((radius * 2) > w)
+        radius = w / 2;
+    if ((radius * 2) > h)
+        radius = h / 2;
+
+    mode &= ~TFT_GRAD_DITHER;
+    if (mode == TFT_GRAD_RADIAL) {
+        n = isqrt32((int32_t)cx * cx + (int32_t)cy * cy);
+    } else {
+        kx = (mode != TFT_GRAD_V);
+        ky = (mode != TFT_GRAD_H);
+        n = kx * (w - 1) + ky * (h - 1);
+    }
+    if (!n)
+        n = 1;
+
+    start[0] = (c0 >> 11) << 8;
+    start[1] = ((c0 >> 5) & 0x3F) << 8;
+    start[2] = (c0 & 0x1F) << 8;
+    step[0] = (int16_t)(((c1 >> 11) << 8) - start[0]) / n;
+    step[1] = (int16_t)((((c1 >> 5) & 0x3F) << 8) - start[1]) / n;
+    step[2] = (int16_t)(((c1 & 0x1F) << 8) - start[2]) / n;
+
+    y0 = (y < TFT_ROW_MIN) ? TFT_ROW_MIN : y;
+    y1 = ((y + h) > TFT_ROW_MAX) ? TFT_ROW_MAX : (y + h);
+
+    tft_sel();
+
+    for (int16_t row = y0; row < y1;) {
+        int16_t i = row - y;
+        int16_t rows = 1;
+        uint8_t inset = 0;
+
+        if ((i < radius) || (i >= (h - radius))) {
+            /* row of rounded corners */
+            int16_t dy = (i < radius) ? (radius - i) : (i - (h - 1 - radius));
+            inset = radius - isqrt16((uint16_t)radius * radius - (uint16_t)dy * dy + radius);
+        } else {
+            /* straight rows at once */
+            rows = (((y + h - radius) < y1) ? (y + h - radius) : y1) - row;
+        }
+
+        int16_t xs = ((x + inset) < TFT_COL_MIN) ? TFT_COL_MIN : (x + inset);
+        int16_t xe = ((x + w - inset) > TFT_COL_MAX) ? TFT_COL_MAX : (x + w - inset);
+
+        if (xs < xe) {
+            set_addr_window(xs, row, xe - xs, rows);
+            for (int16_t r = row; r < (row + rows); r++) {
+                const uint8_t *th_row = &bayer4[(r & 3) << 2];
+                int16_t v[3];
+
+                for (uint8_t k = 0; k < 3; k++)
+                    v[k] = start[k] + (int32_t)step[k] * (kx * (xs - x) + ky * (r - y));
+
+                for (int16_t px = xs; px < xe; px++) {
+                    uint8_t th = dither ? ((pgm_read_byte(&th_row[px & 3]) << 4) + 8) : 0x80;
+
+                    if (mode == TFT_GRAD_RADIAL) {
+                        int16_t dx = px - x - cx, dy = r - y - cy;
+                        int16_t d = isqrt32((int32_t)dx * dx + (int32_t)dy * dy);
+
+                        for (uint8_t k = 0; k < 3; k++)
+                            v[k] = start[k] + step[k] * d;
+                    }
+                    write_px((((v[0] + th) >> 8) << 11) |
+                             (((v[1] + th) >> 8) << 5) |
+                             ((v[2] + th) >> 8));
+                    if (kx) {
+                        v[0] += step[0];
+                        v[1] += step[1];
+                        v[2] += step[2];
+                    }
+                }
+            }
+        }
+        row += rows;
+    }
+
+    tft_desel();
+}
+
+/* Panel row of position t on the time axis of strip chart */
+#define chart_row(t) ((TFT_ROT < 2) ? (PANEL_ROW_OFF + (t)) : \
+                                      (PANEL_ROW_OFF + PANEL_H - 1 - (t)))
+
+/*!
+ * @brief Set scroll area and scroll start address
+ * @param top First panel row of scroll area
+ * @param n Number of panel rows in scroll area
+ * @param start Panel row shown at the top of scroll area
+ */
+static void set_scroll(uint8_t top, uint8_t n, uint8_t start) {
+    uint8_t area[6] = {
+        0x00, top,                                  /* Top fixed area */
+        0x00, n,                                    /* Scroll area */
+        0x00, PANEL_GRAM_H - top - n                /* Bottom fixed area */
+    };
+    uint8_t data[2] = {0x00, start};
+
+    tft_sel();
+    write_cmd_data(ST7735_SCRLAR, area, 6);
+    write_cmd_data(ST7735_VSCSAD, data, 2);
+    tft_desel();
+}
+
+/*!
+ * @brief Fill a span of strip chart on the value axis
+ * @param t Position on time axis
+ * @param a Position on value axis
+ * @param b Other position on value axis
+ * @param color 16-bit RGB565 color
+ */
+static void chart_span(uint8_t t, uint8_t a, uint8_t b, uint16_t color) {
+    if (a > b)
+        swap_uint8(&a, &b);
+    if (TFT_ROT & 1)
+        fill_rect(t, a, 1, b - a + 1, color);   // vertical line
+    else
+        fill_rect(a, t, b - a + 1, 1, color);   // horizontal line
+}
+
+/*!
+ * @brief Start a strip chart. The chart advances by one line per sample
+ * by moving the vertical scroll start address, so only the new line
+ * is drawn. Scrolling moves whole panel rows: in landscape the chart
+ * scrolls horizontally and all columns from \p x to \p x + \p w - 1
+ * scroll with it (in portrait - all rows from \p y to \p y + \p h - 1).
+ * Other drawing there is displaced while the chart is running.
+ * @param ch Chart
+ * @param x X-corner of chart
+ * @param y Y-corner of chart
+ * @param w Width of chart
+ * @param h Height of chart
+ * @param fg Trace color
+ * @param bg Background color
+ * @param hist Buffer for a byte per sample on the time axis (\p w in
+ * landscape, \p h in portrait) to erase only old trace; NULL to erase
+ * the whole line
+ */
+void ST7735_chart_init(tft_chart *ch, int16_t x, int16_t y, uint8_t w, uint8_t h,
+                       uint16_t fg, uint16_t bg, uint8_t *hist) {
+    view_org(x, y);
+    if ((x < 0) || (y < 0) || (x >= TFT_W) || (y >= TFT_H))
+        return;
+    if ((x + w) > TFT_W)
+        w = TFT_W - x;
+    if ((y + h) > TFT_H)
+        h = TFT_H - y;
+    if (!w || !h)
         return;
+
+    if (TFT_ROT & 1) {
+        ch->t0 = x;
+        ch->n = w;
+        ch->v0 = y;
+        ch->vn = h;
+    } else {
+        ch->t0 = y;
+        ch->n = h;
+        ch->v0 = x;
+        ch->vn = w;
     }
+    ch->pos = ch->t0;
+    ch->top = (TFT_ROT < 2) ? chart_row(ch->t0) : chart_row(ch->t0 + ch->n - 1);
+    ch->cnt = 0;
+    ch->hist = hist;
+    ch->fg = fg;
+    ch->bg = bg;
+
+    fill_rect(x, y, w, h, bg);
+    set_scroll(ch->top, ch->n, ch->top);
+}
 
-    /* if triangle - vertical line */
-    if ((a_x == b_x) && (a_x == c_x)) {
-        if ((a_x < 0) || (a_x) >= TFT_WIDTH) {
-            tft_desel();
-            return;
-        }
-        write_Vline(a_x, a_y, c_y - a_y + 1, color);
-        tft_desel();
-        return;
+/*!
+ * @brief Add a sample to strip chart. The oldest sample is erased,
+ * the trace is continued from the last sample by a line on the value axis
+ * and the chart is scrolled by one line.
+ * @param ch Chart
+ * @param v Value [0:size of value axis - 1]; up in landscape, right in portrait
+ */
+void ST7735_chart_add(tft_chart *ch, uint8_t v) {
+    uint8_t i = ch->pos - ch->t0;
+    uint8_t c;
+    uint8_t data[2];
+
+    if (v >= ch->vn)
+        v = ch->vn - 1;
+    c = (TFT_ROT & 1) ? (ch->v0 + ch->vn - 1 - v) : (ch->v0 + v);
+
+    if (ch->hist) {
+        /* old trace of this line went from the old previous sample */
+        uint8_t old = (ch->cnt < ch->n) ? c : ch->hist[i];
+
+        if (ch->cnt == ch->n)
+            chart_span(ch->pos, old, ch->prev, ch->bg);
+        ch->hist[i] = c;
+        /* the first line has a dot of its own sample, not a trace
+         * from the last line
+         */
+        ch->prev = (ch->cnt == ch->n - 1) ? ch->hist[0] : old;
+    } else if (ch->cnt == ch->n) {
+        chart_span(ch->pos, ch->v0, ch->v0 + ch->vn - 1, ch->bg);
     }
 
-    dx_c = b_x - a_x;
-    dy_c = b_y - a_y;
-    dx_b = c_x - a_x;
-    dy_b = c_y - a_y;
-    dx_a = c_x - b_x;
-    dy_a = c_y - b_y;
+    chart_span(ch->pos, ch->cnt ? ch->last : c, c, ch->fg);
+    ch->last = c;
+    if (ch->cnt < ch->n)
+        ch->cnt++;
+
+    /* the new line is shown at the end of time axis */
+    data[0] = 0x00;
+    data[1] = chart_row(ch->pos);
+    if (TFT_ROT < 2) {
+        data[1]++;
+        if (data[1] == (ch->top + ch->n))
+            data[1] = ch->top;
+    }
+    tft_sel();
+    write_cmd_data(ST7735_VSCSAD, data, 2);
+    tft_desel();
 
-    ls_x = le_x = a_x;
-    l_y = a_y;
+    if (++ch->pos == (ch->t0 + ch->n))
+        ch->pos = ch->t0;
+}
 
-    d_s = d_e = 0;
+/*!
+ * @brief Stop strip chart scrolling. Scroll area is reset, so the chart
+ * content is shown as it is stored; redraw the chart area after it.
+ */
+void ST7735_chart_stop(void) {
+    set_scroll(0, PANEL_GRAM_H, 0);
+}
 
-    /* upper part of triangle */
-    for (; l_y < b_y; l_y++) {
-        ls_x = a_x + (uint16_t)lround((double)((float)d_s / (float)dy_c));
-        le_x = a_x + (uint16_t)lround((double)((float)d_e / (float)dy_b));
-        d_s += dx_c;
-        d_e += dx_b;
-        if (ls_x > le_x)
-            swap_int16(&ls_x, &le_x);
-        if (ls_x < 0)
-            ls_x = 0;
-        if (le_x >= TFT_WIDTH)
-            le_x = TFT_WIDTH - 1;
-        if ((l_y >= 0) && (l_y < TFT_HEIGHT))
-            write_Hline(ls_x, l_y, le_x - ls_x + 1, color);
+/* Segments of seven-segment digit: a (top), b, c, d (bottom), e, f, g (middle) */
+#define SEG_A 0x01
+#define SEG_B 0x02
+#define SEG_C 0x04
+#define SEG_D 0x08
+#define SEG_E 0x10
+#define SEG_F 0x20
+#define SEG_G 0x40
+
+static const uint8_t seg_digits[10] PROGMEM = {
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,          // 0
+    SEG_B | SEG_C,                                          // 1
+    SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,                  // 2
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                  // 3
+    SEG_B | SEG_C | SEG_F | SEG_G,                          // 4
+    SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,                  // 5
+    SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,          // 6
+    SEG_A | SEG_B | SEG_C,                                  // 7
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,  // 8
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G,          // 9
+};
+
+/* Horizontal distance between digits of seven-segment number */
+#define number_pitch(nm) ((nm)->w + 2 * (nm)->t)
+
+/*!
+ * @brief Fill a segment of seven-segment digit. Segments do not overlap,
+ * so a segment is redrawn without touching the others.
+ * @param nm Number
+ * @param x X-corner of digit
+ * @param seg Segment (SEG_A..SEG_G)
+ * @param color 16-bit RGB565 color
+ */
+static void number_seg(const tft_number *nm, int16_t x, uint8_t seg, uint16_t color) {
+    uint8_t t = nm->t;
+    uint8_t mid = (nm->h - t) / 2;                  // y of middle segment
+    uint8_t lo = mid + t;                           // y of lower vertical segments
+    int16_t y = nm->y;
+
+    switch (seg) {
+    case SEG_A:
+        fill_rect(x + t, y, nm->w - 2 * t, t, color);
+        break;
+    case SEG_G:
+        fill_rect(x + t, y + mid, nm->w - 2 * t, t, color);
+        break;
+    case SEG_D:
+        fill_rect(x + t, y + nm->h - t, nm->w - 2 * t, t, color);
+        break;
+    case SEG_F:
+        fill_rect(x, y + t, t, mid - t, color);
+        break;
+    case SEG_B:
+        fill_rect(x + nm->w - t, y + t, t, mid - t, color);
+        break;
+    case SEG_E:
+        fill_rect(x, y + lo, t, nm->h - t - lo, color);
+        break;
+    case SEG_C:
+        fill_rect(x + nm->w - t, y + lo, t, nm->h - t - lo, color);
+        break;
     }
+}
 
-    /* lower part of triangle */
-    /* division by 0 protection */
-    if (dy_a && dy_b) {
-        d_s = (uint32_t)dx_a * (l_y - b_y);
-        d_e = (uint32_t)dx_b * (l_y - a_y);
-        for (; l_y <= c_y; l_y++) {
-            ls_x = b_x + (uint16_t)lround((double)((float)d_s / (float)dy_a));
-            le_x = a_x + (uint16_t)lround((double)((float)d_e / (float)dy_b));
-            d_s += dx_a;
-            d_e += dx_b;
-            if (ls_x > le_x)
-                swap_int16(&ls_x, &le_x);
-            if (ls_x < 0)
-                ls_x = 0;
-            if (le_x >= TFT_WIDTH)
-                le_x = TFT_WIDTH - 1;
-            if ((l_y >= 0) && (l_y < TFT_HEIGHT))
-                write_Hline(ls_x, l_y, le_x - ls_x + 1, color);
+/*!
+ * @brief Start a seven-segment number. The area is cleared and the decimal
+ * point is drawn; digits are drawn by ST7735_number_set().
+ * @param nm Number
+ * @param x X-corner of number
+ * @param y Y-corner of number
+ * @param n Number of digits [1:TFT_NUMBER_DIGITS]
+ * @param frac Number of digits after decimal point; 0 for integer
+ * @param w Digit width; at least 2 * \p t + 1
+ * @param h Digit height; at least 3 * \p t + 2
+ * @param t Segment thickness; digits are 2 * \p t apart
+ * @param fg Segment color
+ * @param bg Background color
+ */
+void ST7735_number_init(tft_number *nm, int16_t x, int16_t y, uint8_t n, uint8_t frac,
+                        uint8_t w, uint8_t h, uint8_t t, uint16_t fg, uint16_t bg) {
+    view_org(x, y);
+    if (!n)
+        n = 1;
+    if (n > TFT_NUMBER_DIGITS)
+        n = TFT_NUMBER_DIGITS;
+    if (frac >= n)
+        frac = n - 1;
+    if (!t)
+        t = 1;
+    if (w < 2 * t + 1)
+        w = 2 * t + 1;
+    if (h < 3 * t + 2)
+        h = 3 * t + 2;
+
+    nm->x = x;
+    nm->y = y;
+    nm->w = w;
+    nm->h = h;
+    nm->t = t;
+    nm->n = n;
+    nm->frac = frac;
+    nm->fg = fg;
+    nm->bg = bg;
+    memset(nm->segs, 0, sizeof(nm->segs));
+
+    fill_rect(x, y, n * number_pitch(nm) - 2 * t, h, bg);
+    if (frac)
+        fill_rect(x + (n - frac - 1) * number_pitch(nm) + w + t / 2, y + h - t, t, t, fg);
+}
+
+/*!
+ * @brief Show a value on seven-segment number. Only the segments
+ * that differ from the previous value are drawn, so unchanged digits
+ * cost no SPI traffic. Values that do not fit are shown as dashes.
+ * @param nm Number
+ * @param value Value in units of the last digit (e.g. 235 is 23.5 with 1 fraction digit)
+ */
+void ST7735_number_set(tft_number *nm, int32_t value) {
+    bool neg = value < 0;
+    uint32_t u = neg ? -(uint32_t)value : (uint32_t)value;
+    uint8_t segs[TFT_NUMBER_DIGITS];
+    uint8_t i;
+    int16_t x;
+
+    /* right to left; leading zeros are blank up to the units digit */
+    for (i = nm->n; i-- > 0;) {
+        if (u || ((nm->n - 1 - i) <= nm->frac)) {
+            segs[i] = pgm_read_byte(&seg_digits[u % 10]);
+            u /= 10;
+        } else if (neg) {
+            segs[i] = SEG_G;
+            neg = false;
+        } else {
+            segs[i] = 0;
         }
-    } else {
-        ls_x = b_x;
-        le_x = c_x;
-        if (ls_x > le_x)
-            swap_int16(&ls_x, &le_x);
-        if (ls_x < 0)
-            ls_x = 0;
-        if (le_x >= TFT_WIDTH)
-            le_x = TFT_WIDTH - 1;
-        if ((l_y >= 0) && (l_y < TFT_HEIGHT))
-            write_Hline(ls_x, l_y, le_x - ls_x + 1, color);
     }
+    if (u || neg)
+        memset(segs, SEG_G, nm->n);
 
-    tft_desel();
+    for (i = 0, x = nm->x; i < nm->n; i++, x += number_pitch(nm)) {
+        uint8_t diff = segs[i] ^ nm->segs[i];
+        uint8_t seg;
+
+        for (seg = SEG_A; diff; seg <<= 1) {
+            if (diff & seg) {
+                number_seg(nm, x, seg, (segs[i] & seg) ? nm->fg : nm->bg);
+                diff &= ~seg;
+            }
+        }
+        nm->segs[i] = segs[i];
+    }
 }
 
 /*!
  * @brief Set the cursor position by \p x & \p y coordinates
- * @param x Horizontal cursor position (pix if pixel mode; column else)
- * @param y Vertical cursor position (pix if pixel mode; column else)
+ * @param x Horizontal cursor position (pix in viewport if pixel mode; column else)
+ * @param y Vertical cursor position (pix in viewport if pixel mode; column else)
  */
 void ST7735_set_cursor(int16_t x, int16_t y) {
-    if (st7735.tft_flags & _BV(TFT_PIX_TEXT)) {
+    if (tft->tft_flags & _BV(TFT_PIX_TEXT)) {
         /* if pixel mode */
-        st7735.tft_cursor_x = x;
-        st7735.tft_cursor_y = y;
+        view_org(x, y);
+        tft->tft_cursor_x = x;
+        tft->tft_cursor_y = y;
     } else {
         /* if char-pos mode */
-        st7735.tft_cursor = TFT_CURSOR_MAX_C * y + x;
+        tft->tft_cursor = CURSOR_MAX_C * y + x;
 
-        if (st7735.tft_cursor > (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R))
-            st7735.tft_cursor -= ((st7735.tft_cursor / (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R)) *
-                                  (TFT_CURSOR_MAX_C * TFT_CURSOR_MAX_R));
+        if (tft->tft_cursor > (CURSOR_MAX_C * CURSOR_MAX_R))
+            tft->tft_cursor -= ((tft->tft_cursor / (CURSOR_MAX_C * CURSOR_MAX_R)) *
+                                  (CURSOR_MAX_C * CURSOR_MAX_R));
         
-        st7735.tft_cursor_x = (st7735.tft_cursor % TFT_CURSOR_MAX_C) * (FONT_5X7_WIDTH + 1);
-        st7735.tft_cursor_y = (st7735.tft_cursor / TFT_CURSOR_MAX_C) * (FONT_5X7_HEIGHT + 1);
+        tft->tft_cursor_x = (tft->tft_cursor % CURSOR_MAX_C) * CHAR_W;
+        tft->tft_cursor_y = (tft->tft_cursor / CURSOR_MAX_C) * CHAR_H;
     }
 }
 
@@ -1039,23 +3854,27 @@ void ST7735_set_cursor(int16_t x, int16_t y) {
  * @return Cursor position in number of chars
  */
 int16_t ST7735_get_cursor(void) {
-    return st7735.tft_cursor;
+    return tft->tft_cursor;
 }
 
 /*!
  * @brief Get X-coord of the cursor position in pix
- * @return X-coordinate of cursor
+ * @return X-coordinate of cursor (in viewport if pixel mode)
  */
 int16_t ST7735_get_cursor_x(void) {
-    return st7735.tft_cursor_x;
+    if (tft->tft_flags & _BV(TFT_PIX_TEXT))
+        return tft->tft_cursor_x - tft->view.org_x;
+    return tft->tft_cursor_x;
 }
 
 /*!
  * @brief Get Y-coord of the cursor position in pix
- * @return Y-coordinate of cursor
+ * @return Y-coordinate of cursor (in viewport if pixel mode)
  */
 int16_t ST7735_get_cursor_y(void) {
-    return st7735.tft_cursor_y;
+    if (tft->tft_flags & _BV(TFT_PIX_TEXT))
+        return tft->tft_cursor_y - tft->view.org_y;
+    return tft->tft_cursor_y;
 }
 
 /*!
@@ -1063,7 +3882,10 @@ int16_t ST7735_get_cursor_y(void) {
  * @param color 16-bit RGB565 color
  */
 void ST7735_set_text_color(uint16_t color) {
-    st7735.tft_text_color = color;
+    if (tft->tft_text_color == color)
+        return;
+    tft->tft_text_color = color;
+    text_lut_upd();
 }
 
 /*!
@@ -1071,7 +3893,10 @@ void ST7735_set_text_color(uint16_t color) {
  * @param color 16-bit RGB565 color
  */
 void ST7735_set_text_bg_color(uint16_t color) {
-    st7735.tft_text_bg_color = color;
+    if (tft->tft_text_bg_color == color)
+        return;
+    tft->tft_text_bg_color = color;
+    text_lut_upd();
 }
 
 /*!
@@ -1081,7 +3906,7 @@ void ST7735_set_text_bg_color(uint16_t color) {
  * on the selected background color.
  */
 void ST7735_transp_text(bool mode) {
-    bit_write(st7735.tft_flags, TFT_TRANSP_TEXT, mode);
+    bit_write(tft->tft_flags, TFT_TRANSP_TEXT, mode);
 }
 
 /*!
@@ -1089,7 +3914,7 @@ void ST7735_transp_text(bool mode) {
  * @param mode \c true or \c false
  */
 void ST7735_wrap_text(bool mode) {
-    bit_write(st7735.tft_flags, TFT_WRAP_TEXT, mode);
+    bit_write(tft->tft_flags, TFT_WRAP_TEXT, mode);
 }
 
 /*!
@@ -1097,35 +3922,249 @@ void ST7735_wrap_text(bool mode) {
  * @param mode \c true or \c false
  */
 void ST7735_pix_text(bool mode) {
-    bit_write(st7735.tft_flags, TFT_PIX_TEXT, mode);
+    bit_write(tft->tft_flags, TFT_PIX_TEXT, mode);
 }
 
 /*!
- * @brief Set printing mode (symbols by CP437 or char by ASCII)
+ * @brief Set printing mode (symbols by CP437 or char by ASCII).
+ * In char mode control chars are interpreted; bytes above ASCII
+ * are CP437 codes, or are decoded as UTF-8 to CP437 glyphs with TFT_UTF8.
  * @param mode \c true for symbols or \c false for chars
  */
 void ST7735_symbol_text(bool mode) {
-    bit_write(st7735.tft_flags, TFT_SYM_TEXT, mode);
+    bit_write(tft->tft_flags, TFT_SYM_TEXT, mode);
+#ifdef TFT_UTF8
+    tft->utf8_left = 0;
+#endif
 }
 
 /*!
- * @brief Send one character to the screen.
+ * @brief Set text scale. Characters are drawn \p scale times larger
+ * and the text grid of char-pos mode is recalculated for the new cell size.
+ * @param scale Scale factor [1:4]; reduced while the char cell is larger
+ * than the screen
+ */
+void ST7735_text_scale(uint8_t scale) {
+    if (scale < 1)
+        scale = 1;
+    if (scale > 4)
+        scale = 4;
+    while ((scale > 1) && (((tft->font_w * scale) > PANEL_W) ||
+                           ((tft->font_h * scale) > PANEL_W)))
+        scale--;
+    tft->text_scale = scale;
+    tft->cursor_max_c = TFT_W / CHAR_W;
+    tft->cursor_max_r = TFT_H / CHAR_H;
+
+    if (!(tft->tft_flags & _BV(TFT_PIX_TEXT))) {
+        tft->tft_cursor %= CURSOR_MAX_C * CURSOR_MAX_R;
+        tft->tft_cursor_x = (tft->tft_cursor % CURSOR_MAX_C) * CHAR_W;
+        tft->tft_cursor_y = (tft->tft_cursor / CURSOR_MAX_C) * CHAR_H;
+    }
+}
+
+/*!
+ * @brief Set font of text. The char cell of char-pos mode is the max
+ * advance by the line height of the font; in pixel mode the cursor
+ * moves by the advance of each glyph.
+ * @param font PROGMEM font; NULL for the built-in 5x7 font
+ * @return \c false if the font is not supported (too large cell or
+ * unknown bpp); the built-in 5x7 font is set then
+ */
+bool ST7735_set_font(const tft_font *font) {
+    bool ok = true;
+
+    if (font) {
+        memcpy_P(&tft->font, font, sizeof(tft->font));
+        ok = tft->font.width && (tft->font.width <= 32) &&
+             tft->font.height && (tft->font.height <= PANEL_W) &&
+             (tft->font.bpp != 3) && (tft->font.bpp <= 4);
+    }
+    if (font && ok) {
+        tft->font_w = tft->font.width;
+        tft->font_h = tft->font.height;
+    } else {
+        tft->font.glyphs = NULL;
+        tft->font_w = FONT_5X7_WIDTH + 1;
+        tft->font_h = FONT_5X7_HEIGHT + 1;
+    }
+    ST7735_text_scale(tft->text_scale);
+
+    return ok;
+}
+
+/*!
+ * @brief Find glyph of proportional font
+ * @param c Char code
+ * @param g Glyph
+ * @return \c true if the font has a glyph for \p c
+ */
+static bool font_glyph(uint8_t c, tft_glyph *g) {
+    const tft_font_range *r = tft->font.ranges;
+    tft_font_range range;
+
+    for (uint8_t i = tft->font.n_ranges; i; i--, r++) {
+        memcpy_P(&range, r, sizeof(range));
+        if (c < range.first)
+            break;
+        if (c <= range.last) {
+            memcpy_P(g, &tft->font.glyphs[range.glyph + c - range.first], sizeof(*g));
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * @brief Get a row of proportional glyph as bits of char cell columns
+ * @param g Glyph
+ * @param row Row of char cell
+ * @return Bit n is set if column n of the cell is set
+ */
+static uint32_t glyph_row(const tft_glyph *g, uint8_t row) {
+    int8_t gy = row - (int8_t)tft->font.ascent - g->y_off;
+    uint32_t bits = 0;
+    uint16_t b;
+
+    if ((gy < 0) || (gy >= g->height))
+        return 0;
+    b = g->offset + gy * g->width;
+    for (uint8_t i = 0; i < g->width; i++, b++) {
+        int8_t x = g->x_off + i;
+
+        if ((x >= 0) && (x < 32) &&
+            (pgm_read_byte(&tft->font.bitmap[b >> 3]) & (0x80 >> (b & 7))))
+            bits |= 1UL << x;
+    }
+    return bits;
+}
+
+/*!
+ * @brief Get a row of anti-aliased glyph as alpha of char cell columns
+ * @param g Glyph
+ * @param row Row of char cell
+ * @param lv 4-bit alpha (index of text_lut) of 32 cell columns
+ */
+static void glyph_levels(const tft_glyph *g, uint8_t row, uint8_t *lv) {
+    int8_t gy = row - (int8_t)tft->font.ascent - g->y_off;
+    uint8_t bpp = tft->font.bpp;
+    uint8_t mask = (1U << bpp) - 1;
+    uint16_t bit;
+
+    memset(lv, 0, 32);
+    if ((gy < 0) || (gy >= g->height))
+        return;
+    bit = g->offset + (uint16_t)gy * g->width * bpp;
+    for (uint8_t i = 0; i < g->width; i++, bit += bpp) {
+        int8_t x = g->x_off + i;
+
+        if ((x >= 0) && (x < 32)) {
+            uint8_t v = pgm_read_byte(&tft->font.bitmap[bit >> 3]);
+            lv[x] = ((v >> (8 - bpp - (bit & 7))) & mask) * (15 / mask);
+        }
+    }
+}
+
+/*!
+ * @brief Draw visible part of anti-aliased glyph in char cell.
+ * Opaque glyph is written in one window from text_lut by runs of the
+ * same alpha. Transparent glyph fills solid runs and blends edges over
+ * display memory (read back).
+ * @param g Glyph
+ * @param x X-corner of char cell
+ * @param y Y-corner of char cell
+ * @param c0 First visible column of cell
+ * @param c1 Last visible column of cell + 1
+ * @param r0 First visible row of cell
+ * @param r1 Last visible row of cell + 1
+ * @param transp Transparent text
+ */
+static void put_glyph_aa(const tft_glyph *g, int16_t x, int16_t y, uint8_t c0, uint8_t c1,
+                         uint8_t r0, uint8_t r1, bool transp) {
+    uint8_t s = tft->text_scale;
+    uint8_t lv[32];
+    uint8_t rn, i, n;
+
+    if (!transp) {
+        tft_sel();
+        set_addr_window(x + c0, y + r0, c1 - c0, r1 - r0);
+    }
+
+    for (uint8_t row = r0; row < r1; row += rn) {
+        glyph_levels(g, row / s, lv);
+        rn = s - row % s;
+        if ((row + rn) > r1)
+            rn = r1 - row;
+
+        for (uint8_t k = transp ? 1 : rn; k; k--) {
+            for (i = c0; i < c1; i = n) {
+                uint8_t v = lv[i / s];
+
+                n = i;
+                do {
+                    n = (n / s + 1) * s;
+                } while ((n < c1) && (lv[n / s] == v));
+                if (n > c1)
+                    n = c1;
+
+                if (!transp) {
+                    write_color(tft->text_lut[v], n - i);
+                } else if (v == 15) {
+                    tft_sel();
+                    set_addr_window(x + i, y + row, n - i, rn);
+                    write_color(tft->tft_text_color, (n - i) * rn);
+                    tft_desel();
+                } else if (v) {
+                    uint8_t a = pgm_read_byte(&alpha4_32[v]);
+
+                    for (uint8_t r = 0; r < rn; r++) {
+                        for (uint16_t j = i; j < n; j += TFT_COPY_BUF) {
+                            uint8_t m = ((n - j) < TFT_COPY_BUF) ? (n - j) : TFT_COPY_BUF;
+                            blend_span(x + j, y + row + r, m, tft->tft_text_color, NULL, a);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (!transp)
+        tft_desel();
+}
+
+/*!
+ * @brief Move the cursor past a character
+ * @param g Glyph of proportional font; NULL for a char cell
+ */
+static void cursor_adv(const tft_glyph *g) {
+    if (g && (tft->tft_flags & _BV(TFT_PIX_TEXT)))
+        tft->tft_cursor_x += g->x_adv * tft->text_scale;
+    else
+        cursor_upd(1);
+}
+
+/*!
+ * @brief Send one character to the screen of selected device.
  * @param c Sending char
- * @param stream Stream to sending
+ * @param sym Print control chars as symbols
  */
-int ST7735_put_char(char c, FILE *stream) {
-    if ((st7735.tft_cursor_x >= TFT_WIDTH) ||
-        (st7735.tft_cursor_y >= TFT_HEIGHT) ||
-        ((st7735.tft_cursor_x + FONT_5X7_WIDTH + 1) < 0) ||
-        ((st7735.tft_cursor_y + FONT_5X7_HEIGHT + 1) < 0)) {
+static int put_char(char c, bool sym) {
+    tft_glyph glyph;
+    const tft_glyph *g = (tft->font.glyphs && font_glyph(c, &glyph)) ? &glyph : NULL;
+    bool outside = (tft->tft_cursor_x >= TFT_COL_MAX) ||
+                   (tft->tft_cursor_y >= TFT_ROW_MAX) ||
+                   ((tft->tft_cursor_x + CHAR_W) <= TFT_COL_MIN) ||
+                   ((tft->tft_cursor_y + CHAR_H) <= TFT_ROW_MIN);
+
+    if (outside) {
         /* checking if the given character is printed
            outside the screen boundaries */
-        if (st7735.tft_flags & _BV(TFT_PIX_TEXT)) {
-            cursor_upd(1);
+        if (tft->tft_flags & _BV(TFT_PIX_TEXT)) {
+            cursor_adv(g);
             return 0;
         }
     }
-    if (!(st7735.tft_flags & _BV(TFT_SYM_TEXT))) {
+    if (!sym) {
         uint8_t tmp_val;
         switch (c) {
             case 0x00:  // ^@ \0 NULL
@@ -1142,15 +4181,15 @@ int ST7735_put_char(char c, FILE *stream) {
                 cursor_upd(-1);
                 return 0;
             case 0x09:  // ^I \t TAB
-                tmp_val = (st7735.tft_cursor % TFT_CURSOR_MAX_C);  // curr column
-                if ((tmp_val / 4) < 5)
+                tmp_val = (tft->tft_cursor % CURSOR_MAX_C);  // curr column
+                if (tmp_val < ((CURSOR_MAX_C - 1) & ~3U))
                     cursor_upd(4 - (tmp_val % 4));
                 return 0;
             case 0x0A:  // ^J \n New Line
-                tmp_val = (st7735.tft_cursor % TFT_CURSOR_MAX_C);  // curr column
-                cursor_upd(TFT_CURSOR_MAX_C - (tmp_val % TFT_CURSOR_MAX_C));
-                ST7735_draw_fill_rect(0, st7735.tft_cursor_y, TFT_WIDTH,
-                                      (FONT_5X7_HEIGHT + 1) * 2, st7735.tft_text_bg_color);
+                tmp_val = (tft->tft_cursor % CURSOR_MAX_C);  // curr column
+                cursor_upd(CURSOR_MAX_C - (tmp_val % CURSOR_MAX_C));
+                fill_rect(0, tft->tft_cursor_y, TFT_W,
+                          CHAR_H * 2, tft->tft_text_bg_color);
                 return 0;
             // case 0x0B:  // ^K \v
             // case 0x0C:  // ^L \f
@@ -1182,70 +4221,630 @@ int ST7735_put_char(char c, FILE *stream) {
                 break;
         }
     }
+    if (outside) {
+        /* e.g. out of partial area */
+        cursor_adv(g);
+        return 0;
+    }
     
-    uint8_t tmp_ch;
+    /* visible part of character cell; clipped once */
+    int16_t x = tft->tft_cursor_x;
+    int16_t y = tft->tft_cursor_y;
+    uint8_t s = tft->text_scale;
+    uint8_t c0 = (x < TFT_COL_MIN) ? (TFT_COL_MIN - x) : 0;
+    uint8_t r0 = (y < TFT_ROW_MIN) ? (TFT_ROW_MIN - y) : 0;
+    uint8_t cw = (g && (tft->tft_flags & _BV(TFT_PIX_TEXT))) ? (g->x_adv * s) : CHAR_W;
+    uint8_t c1 = ((x + cw) > TFT_COL_MAX) ? (TFT_COL_MAX - x) : cw;
+    uint8_t r1 = ((y + CHAR_H) > TFT_ROW_MAX) ? (TFT_ROW_MAX - y) : CHAR_H;
+    bool transp = tft->tft_flags & _BV(TFT_TRANSP_TEXT);
+    uint32_t tmp_ch = 0;
+    uint8_t rn, i, n;
+
+    if (g && (tft->font.bpp > 1)) {
+        put_glyph_aa(g, x, y, c0, c1, r0, r1, transp);
+        cursor_adv(g);
+        return 0;
+    }
     
     tft_sel();
     
-    if (!(st7735.tft_flags & _BV(TFT_TRANSP_TEXT))) {
-        /* if transparency is off, check and restrict
-           the address window for the symbol */
-        int16_t tmp_x = st7735.tft_cursor_x;
-        int16_t tmp_y = st7735.tft_cursor_y;
-        uint8_t tmp_w = FONT_5X7_WIDTH + 1;
-        uint8_t tmp_h = FONT_5X7_HEIGHT + 1;
-
-        if (tmp_x < 0) {
-            tmp_w = (uint8_t)(tmp_w + tmp_x);
-            tmp_x = 0;
-        }
-        if (tmp_y < 0) {
-            tmp_h = (uint8_t)(tmp_h + tmp_y);
-            tmp_y = 0;
-        }
-        if ((tmp_x + tmp_w) >= TFT_WIDTH)
-            tmp_w = (uint8_t)(TFT_WIDTH - tmp_x);
-        if ((tmp_y + tmp_h) >= TFT_HEIGHT)
-            tmp_h = (uint8_t)(TFT_HEIGHT - tmp_y);
-
-        set_addr_window(tmp_x, tmp_y,
-                        tmp_w, tmp_h);
+    if (!transp) {
+        /* if transparency is off, the window is the visible part */
+        set_addr_window(x + c0, y + r0, c1 - c0, r1 - r0);
     }
 
-    for (uint8_t row = 0; row <= FONT_5X7_HEIGHT; row++) {
-        tmp_ch = pgm_read_byte(&font5x7_cp437[(uint8_t)c][row]);
-        for (uint8_t i = 0; i <= FONT_5X7_WIDTH; i++) {
-            if (((st7735.tft_cursor_x + i) < 0) || ((st7735.tft_cursor_x + i) >= TFT_WIDTH) ||
-                ((st7735.tft_cursor_y + row) < 0) || ((st7735.tft_cursor_y + row) >= TFT_HEIGHT)) {
-                /* skip if the pixel is outside the screen */
-                continue;
+    for (uint8_t row = r0; row < r1; row += rn) {
+        if (g)
+            tmp_ch = glyph_row(g, row / s);
+        else if (!tft->font.glyphs)
+            tmp_ch = pgm_read_byte(&font5x7_cp437[(uint8_t)c][row / s]);
+        /* screen rows of this font row */
+        rn = s - row % s;
+        if ((row + rn) > r1)
+            rn = r1 - row;
+
+        /* runs of the same font bits; a transparent run is drawn once
+           as a span of rn rows, an opaque row is written rn times */
+        for (uint8_t k = transp ? 1 : rn; k; k--) {
+            for (i = c0; i < c1; i = n) {
+                bool on = (tmp_ch >> (i / s)) & 1;
+
+                n = i;
+                do {
+                    n = (n / s + 1) * s;
+                } while ((n < c1) && (((tmp_ch >> (n / s)) & 1) == on));
+                if (n > c1)
+                    n = c1;
+
+                if (!transp) {
+                    write_color(on ? tft->tft_text_color : tft->tft_text_bg_color, n - i);
+                } else if (on) {
+                    set_addr_window(x + i, y + row, n - i, rn);
+                    write_color(tft->tft_text_color, (n - i) * rn);
                 }
-            if (st7735.tft_flags & _BV(TFT_TRANSP_TEXT)) {
-                /* if transparent mode on */
-                if (tmp_ch & _BV(i)) {
-                    write_pixel(st7735.tft_cursor_x + i,
-                                st7735.tft_cursor_y + row,
-                                st7735.tft_text_color);
-                }
-            } else {
-                /* if transparent mode off */
-                if (tmp_ch & _BV(i))
-                    spi_write16(st7735.tft_text_color);
-                else
-                    spi_write16(st7735.tft_text_bg_color);
             }
         }
     }
     
     tft_desel();
-    cursor_upd(1);
+    cursor_adv(g);
     
     return 0;
 }
 
+#ifdef TFT_UTF8
+/* Unicode code points of CP437 glyphs, sorted by code point */
+static const struct {
+    uint16_t cp;
+    uint8_t code;
+} utf8_cp437[] PROGMEM = {
+    {0x00A0, 0xFF}, {0x00A1, 0xAD}, {0x00A2, 0x9B}, {0x00A3, 0x9C},   //   ¡ ¢ £
+    {0x00A5, 0x9D}, {0x00A7, 0x15}, {0x00AA, 0xA6}, {0x00AB, 0xAE},   // ¥ § ª «
+    {0x00AC, 0xAA}, {0x00B0, 0xF8}, {0x00B1, 0xF1}, {0x00B2, 0xFD},   // ¬ ° ± ²
+    {0x00B5, 0xE6}, {0x00B6, 0x14}, {0x00B7, 0xFA}, {0x00BA, 0xA7},   // µ ¶ · º
+    {0x00BB, 0xAF}, {0x00BC, 0xAC}, {0x00BD, 0xAB}, {0x00BF, 0xA8},   // » ¼ ½ ¿
+    {0x00C4, 0x8E}, {0x00C5, 0x8F}, {0x00C6, 0x92}, {0x00C7, 0x80},   // Ä Å Æ Ç
+    {0x00C9, 0x90}, {0x00D1, 0xA5}, {0x00D6, 0x99}, {0x00DC, 0x9A},   // É Ñ Ö Ü
+    {0x00DF, 0xE1}, {0x00E0, 0x85}, {0x00E1, 0xA0}, {0x00E2, 0x83},   // ß à á â
+    {0x00E4, 0x84}, {0x00E5, 0x86}, {0x00E6, 0x91}, {0x00E7, 0x87},   // ä å æ ç
+    {0x00E8, 0x8A}, {0x00E9, 0x82}, {0x00EA, 0x88}, {0x00EB, 0x89},   // è é ê ë
+    {0x00EC, 0x8D}, {0x00ED, 0xA1}, {0x00EE, 0x8C}, {0x00EF, 0x8B},   // ì í î ï
+    {0x00F1, 0xA4}, {0x00F2, 0x95}, {0x00F3, 0xA2}, {0x00F4, 0x93},   // ñ ò ó ô
+    {0x00F6, 0x94}, {0x00F7, 0xF6}, {0x00F9, 0x97}, {0x00FA, 0xA3},   // ö ÷ ù ú
+    {0x00FB, 0x96}, {0x00FC, 0x81}, {0x00FF, 0x98}, {0x0192, 0x9F},   // û ü ÿ ƒ
+    {0x0393, 0xE2}, {0x0398, 0xE9}, {0x03A3, 0xE4}, {0x03A6, 0xE8},   // Γ Θ Σ Φ
+    {0x03A9, 0xEA}, {0x03B1, 0xE0}, {0x03B2, 0xE1}, {0x03B4, 0xEB},   // Ω α β δ
+    {0x03B5, 0xEE}, {0x03C0, 0xE3}, {0x03C3, 0xE5}, {0x03C4, 0xE7},   // ε π σ τ
+    {0x03C6, 0xED}, {0x2022, 0x07}, {0x203C, 0x13}, {0x207F, 0xFC},   // φ • ‼ ⁿ
+    {0x20A7, 0x9E}, {0x2126, 0xEA}, {0x2190, 0x1B}, {0x2191, 0x18},   // ₧ Ω ← ↑
+    {0x2192, 0x1A}, {0x2193, 0x19}, {0x2194, 0x1D}, {0x2195, 0x12},   // → ↓ ↔ ↕
+    {0x21A8, 0x17}, {0x2205, 0xED}, {0x2208, 0xEE}, {0x2211, 0xE4},   // ↨ ∅ ∈ ∑
+    {0x2219, 0xF9}, {0x221A, 0xFB}, {0x221E, 0xEC}, {0x221F, 0x1C},   // ∙ √ ∞ ∟
+    {0x2229, 0xEF}, {0x2248, 0xF7}, {0x2261, 0xF0}, {0x2264, 0xF3},   // ∩ ≈ ≡ ≤
+    {0x2265, 0xF2}, {0x2302, 0x7F}, {0x2310, 0xA9}, {0x2320, 0xF4},   // ≥ ⌂ ⌐ ⌠
+    {0x2321, 0xF5}, {0x2500, 0xC4}, {0x2502, 0xB3}, {0x250C, 0xDA},   // ⌡ ─ │ ┌
+    {0x2510, 0xBF}, {0x2514, 0xC0}, {0x2518, 0xD9}, {0x251C, 0xC3},   // ┐ └ ┘ ├
+    {0x2524, 0xB4}, {0x252C, 0xC2}, {0x2534, 0xC1}, {0x253C, 0xC5},   // ┤ ┬ ┴ ┼
+    {0x2550, 0xCD}, {0x2551, 0xBA}, {0x2552, 0xD5}, {0x2553, 0xD6},   // ═ ║ ╒ ╓
+    {0x2554, 0xC9}, {0x2555, 0xB8}, {0x2556, 0xB7}, {0x2557, 0xBB},   // ╔ ╕ ╖ ╗
+    {0x2558, 0xD4}, {0x2559, 0xD3}, {0x255A, 0xC8}, {0x255B, 0xBE},   // ╘ ╙ ╚ ╛
+    {0x255C, 0xBD}, {0x255D, 0xBC}, {0x255E, 0xC6}, {0x255F, 0xC7},   // ╜ ╝ ╞ ╟
+    {0x2560, 0xCC}, {0x2561, 0xB5}, {0x2562, 0xB6}, {0x2563, 0xB9},   // ╠ ╡ ╢ ╣
+    {0x2564, 0xD1}, {0x2565, 0xD2}, {0x2566, 0xCB}, {0x2567, 0xCF},   // ╤ ╥ ╦ ╧
+    {0x2568, 0xD0}, {0x2569, 0xCA}, {0x256A, 0xD8}, {0x256B, 0xD7},   // ╨ ╩ ╪ ╫
+    {0x256C, 0xCE}, {0x2580, 0xDF}, {0x2584, 0xDC}, {0x2588, 0xDB},   // ╬ ▀ ▄ █
+    {0x258C, 0xDD}, {0x2590, 0xDE}, {0x2591, 0xB0}, {0x2592, 0xB1},   // ▌ ▐ ░ ▒
+    {0x2593, 0xB2}, {0x25A0, 0xFE}, {0x25AC, 0x16}, {0x25B2, 0x1E},   // ▓ ■ ▬ ▲
+    {0x25BA, 0x10}, {0x25BC, 0x1F}, {0x25C4, 0x11}, {0x25CB, 0x09},   // ► ▼ ◄ ○
+    {0x25D8, 0x08}, {0x25D9, 0x0A}, {0x263A, 0x01}, {0x263B, 0x02},   // ◘ ◙ ☺ ☻
+    {0x263C, 0x0F}, {0x2640, 0x0C}, {0x2642, 0x0B}, {0x2660, 0x06},   // ☼ ♀ ♂ ♠
+    {0x2663, 0x05}, {0x2665, 0x03}, {0x2666, 0x04}, {0x266A, 0x0D},   // ♣ ♥ ♦ ♪
+    {0x266B, 0x0E},   // ♫
+};
+
+/*!
+ * @brief Find CP437 glyph of Unicode code point by binary search
+ * @param cp Code point
+ * @param len Number of continuation bytes it was encoded with
+ * @return CP437 code; TFT_UTF8_REPL if the encoding is overlong
+ * or there is no such glyph
+ */
+static uint8_t utf8_glyph(uint32_t cp, uint8_t len) {
+    uint8_t lo = 0;
+    uint8_t hi = sizeof(utf8_cp437) / sizeof(utf8_cp437[0]);
+
+    if ((len == 2) ? (cp < 0x800) : (len == 3) ? (cp < 0x10000) : (cp < 0x80))
+        return TFT_UTF8_REPL;
+    if (cp > 0xFFFF)
+        return TFT_UTF8_REPL;
+
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        uint16_t v = pgm_read_word(&utf8_cp437[mid].cp);
+
+        if (v == cp)
+            return pgm_read_byte(&utf8_cp437[mid].code);
+        if (v < cp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return TFT_UTF8_REPL;
+}
+
+/*!
+ * @brief Decode a byte of UTF-8 text. Complete characters are printed
+ * by CP437 glyphs; malformed sequences are printed as TFT_UTF8_REPL.
+ * @param b Byte of text
+ */
+static int put_utf8(uint8_t b) {
+    if ((b & 0xC0) == 0x80) {
+        /* continuation byte */
+        if (!tft->utf8_left)
+            return put_char(TFT_UTF8_REPL, true);
+        tft->utf8_cp = (tft->utf8_cp << 6) | (b & 0x3F);
+        if (--tft->utf8_left)
+            return 0;
+        return put_char(utf8_glyph(tft->utf8_cp, tft->utf8_len), true);
+    }
+
+    if (tft->utf8_left) {
+        /* sequence is cut short */
+        tft->utf8_left = 0;
+        put_char(TFT_UTF8_REPL, true);
+    }
+    if (b < 0x80)
+        return put_char(b, false);
+    if ((b < 0xC2) || (b > 0xF4))
+        return put_char(TFT_UTF8_REPL, true);
+
+    /* lead byte: 2, 3 or 4 byte sequence */
+    tft->utf8_left = (b >= 0xF0) ? 3 : (b >= 0xE0) ? 2 : 1;
+    tft->utf8_len = tft->utf8_left;
+    tft->utf8_cp = b & (0x3F >> tft->utf8_left);
+    return 0;
+}
+#endif  /* TFT_UTF8 */
+
+/*!
+ * @brief Send one byte of text to the selected device. ASCII goes
+ * straight to put_char(); in char mode with TFT_UTF8 other bytes are
+ * UTF-8, otherwise they are CP437 codes.
+ * @param c Sending char
+ */
+static int put_text(char c) {
+#ifdef TFT_UTF8
+    if (!(c & 0x80) && !tft->utf8_left)
+        return put_char(c, tft->tft_flags & _BV(TFT_SYM_TEXT));
+    if (tft->tft_flags & _BV(TFT_SYM_TEXT))
+        return put_char(c, true);
+    return put_utf8(c);
+#else
+    return put_char(c, tft->tft_flags & _BV(TFT_SYM_TEXT));
+#endif
+}
+
+/*!
+ * @brief Send one character to the screen.
+ * @param c Sending char
+ * @param stream Stream to sending. Stream of any device
+ */
+int ST7735_put_char(char c, FILE *stream) {
+#if TFT_DEVICES > 1
+    struct st7735_dev *prev = tft;
+    int ret;
+
+    ST7735_select(fdev_get_udata(stream));
+    ret = put_text(c);
+    ST7735_select(prev);
+
+    return ret;
+#else
+    (void)stream;
+    return put_text(c);
+#endif
+}
+
+/*!
+ * @brief Get next character of string as printed by the stream:
+ * CP437 code of UTF-8 sequence in char mode with TFT_UTF8, byte otherwise.
+ * Tab is a space and carriage return has no glyph (text functions skip it).
+ * @param s String; moved past the character
+ * @return CP437 code
+ */
+static uint8_t text_next(const char **s) {
+    const uint8_t *p = (const uint8_t *)*s;
+    uint8_t b = *p++;
+
+    *s = (const char *)p;
+    if (b == '\t')
+        return ' ';
+#ifdef TFT_UTF8
+    if ((b < 0x80) || (tft->tft_flags & _BV(TFT_SYM_TEXT)))
+        return b;
+    if ((b < 0xC2) || (b > 0xF4))
+        return TFT_UTF8_REPL;
+
+    uint8_t n = (b >= 0xF0) ? 3 : (b >= 0xE0) ? 2 : 1;
+    uint32_t cp = b & (0x3F >> n);
+
+    for (uint8_t i = 0; i < n; i++, p++) {
+        if ((*p & 0xC0) != 0x80) {
+            /* cut short; next character starts here */
+            *s = (const char *)p;
+            return TFT_UTF8_REPL;
+        }
+        cp = (cp << 6) | (*p & 0x3F);
+    }
+    *s = (const char *)p;
+    return utf8_glyph(cp, n);
+#else
+    return b;
+#endif
+}
+
+/*!
+ * @brief Get cursor advance of character in pixel mode
+ * @param c CP437 code
+ * @return Advance in pixels
+ */
+static uint8_t char_width(uint8_t c) {
+    tft_glyph g;
+
+    if (tft->font.glyphs && font_glyph(c, &g))
+        return g.x_adv * tft->text_scale;
+    return CHAR_W;
+}
+
+/*!
+ * @brief Lay out one line of text. The line is broken at the last space
+ * or tab that fits into \p w, or inside a word longer than \p w; spaces
+ * at the break are dropped. Carriage returns take no width.
+ * @param s Start of line
+ * @param w Max width in pixels; <= 0 for no wrap
+ * @param ln Line; \c len and \c w are set
+ * @return Start of next line
+ */
+static const char *text_line(const char *s, int16_t w, tft_text_line *ln) {
+    const char *p = s;
+    const char *ink = s;        // end of last visible char
+    const char *brk = NULL;     // word after the last space
+    const char *brk_ink = s;    // end of visible chars before that space
+    int16_t x = 0, ink_w = 0, brk_w = 0;
+    bool space = false;
+
+    while (*p && (*p != '\n')) {
+        const char *q = p;
+        uint8_t c = text_next(&q);
+        uint8_t cw;
+
+        if (c == '\r') {
+            p = q;
+            continue;
+        }
+        cw = char_width(c);
+        if ((w > 0) && ((x + cw) > w) && (p != s)) {
+            if (c == ' ') {
+                while ((*p == ' ') || (*p == '\t') || (*p == '\r'))
+                    p++;
+            } else if (space && (ink != s)) {
+                /* word starts here */
+            } else if (brk) {
+                ink = brk_ink;
+                ink_w = brk_w;
+                p = brk;
+            } else {
+                ink = p;
+                ink_w = x;
+            }
+            break;
+        }
+
+        if (c == ' ') {
+            space = true;
+        } else {
+            if (space && (ink != s)) {
+                brk = p;
+                brk_ink = ink;
+                brk_w = ink_w;
+            }
+            space = false;
+            ink = q;
+            ink_w = x + cw;
+        }
+        x += cw;
+        p = q;
+    }
+    if (*p == '\n')
+        p++;
+
+    ln->len = ink - s;
+    ln->w = ink_w;
+    return p;
+}
+
+/*!
+ * @brief Measure width of text in current font and scale, without drawing.
+ * Tab is measured as a space, carriage return takes no width.
+ * @param s String
+ * @param len Number of bytes of \p s
+ * @return Width in pixels
+ */
+int16_t ST7735_text_width(const char *s, uint16_t len) {
+    const char *end = s + len;
+    int16_t w = 0;
+
+    while ((s < end) && *s) {
+        uint8_t c = text_next(&s);
+
+        if (c != '\r')
+            w += char_width(c);
+    }
+    return w;
+}
+
+/*!
+ * @brief Break text into lines by words, without drawing. Lines end at
+ * '\n' and where the next word does not fit into \p w; words are
+ * separated by spaces and tabs, '\r' is ignored.
+ * @param s String
+ * @param w Max line width in pixels; <= 0 for no wrap
+ * @param lines Laid out lines; may be NULL to count them
+ * @param max Size of \p lines
+ * @return Number of lines; may be greater than \p max
+ */
+uint8_t ST7735_layout_text(const char *s, int16_t w, tft_text_line *lines, uint8_t max) {
+    const char *p = s;
+    tft_text_line ln;
+    uint8_t n = 0;
+
+    while (*p) {
+        ln.start = p - s;
+        p = text_line(p, w, &ln);
+        if (lines && (n < max))
+            lines[n] = ln;
+        if (n < UINT8_MAX)
+            n++;
+    }
+    return n;
+}
+
+/*!
+ * @brief Get bounding box of text laid out by ST7735_layout_text()
+ * @param s String
+ * @param w Max line width in pixels; <= 0 for no wrap
+ * @param bw Width of the widest line
+ * @param bh Height of all lines
+ */
+void ST7735_text_bounds(const char *s, int16_t w, int16_t *bw, int16_t *bh) {
+    const char *p = s;
+    tft_text_line ln;
+    int16_t n = 0;
+
+    *bw = 0;
+    while (*p) {
+        p = text_line(p, w, &ln);
+        if (ln.w > *bw)
+            *bw = ln.w;
+        n++;
+    }
+    *bh = n * CHAR_H;
+}
+
+/*!
+ * @brief Draw text broken into lines by words and aligned in a box
+ * (see ST7735_layout_text()); tabs are drawn as spaces.
+ * Colors, transparency, font and scale of text are used; the cursor
+ * and the text mode are not changed.
+ * @param x X-corner of box; with \p w <= 0 - left, center or right point of lines
+ * @param y Y-corner of box
+ * @param w Width of box; <= 0 for no wrap
+ * @param s String
+ * @param align TFT_ALIGN_LEFT, TFT_ALIGN_CENTER or TFT_ALIGN_RIGHT
+ */
+void ST7735_draw_text(int16_t x, int16_t y, int16_t w, const char *s, uint8_t align) {
+    int16_t cur_x = tft->tft_cursor_x;
+    int16_t cur_y = tft->tft_cursor_y;
+    uint8_t flags = tft->tft_flags;
+    int16_t box = (w > 0) ? w : 0;
+    tft_text_line ln;
+
+    view_org(x, y);
+    tft->tft_flags |= _BV(TFT_PIX_TEXT);
+
+    while (*s) {
+        const char *next = text_line(s, w, &ln);
+        const char *end = s + ln.len;
+
+        tft->tft_cursor_x = x;
+        if (align == TFT_ALIGN_RIGHT)
+            tft->tft_cursor_x += box - ln.w;
+        else if (align == TFT_ALIGN_CENTER)
+            tft->tft_cursor_x += (box - ln.w) / 2;
+        tft->tft_cursor_y = y;
+
+        while (s < end) {
+            uint8_t c = text_next(&s);
+
+            if (c != '\r')
+                put_char(c, true);
+        }
+
+        s = next;
+        y += CHAR_H;
+    }
+
+    tft->tft_flags = flags;
+    tft->tft_cursor_x = cur_x;
+    tft->tft_cursor_y = cur_y;
+}
+
+/*!
+ * @brief Get stream of selected device
+ * @return Stream
+ */
+FILE *ST7735_get_stream(void) {
+    return dev_stream(tft);
+}
+
 /*!
- * @brief Set ST7735 as std out
+ * @brief Set selected ST7735 as std out
  */
 void ST7735_set_stdout() {
-    stdout = &st7735_stream;
+    stdout = dev_stream(tft);
+}
+
+#ifdef TFT_DISPLAY_LIST
+
+/*!
+ * @brief Start recording of display list. All following \c ST7735_draw_*
+ * and \c ST7735_fill_screen calls are written to the \p buf instead of display.
+ * Fills, lines and pixels are stored clipped; adjacent fills of the same
+ * color are merged into one window. Coordinates are stored translated
+ * to the screen, shapes are clipped again when the list is drawn.
+ * @param buf Buffer for display list
+ * @param size Size of \p buf
+ */
+void ST7735_dl_record(uint8_t *buf, uint16_t size) {
+    dl.buf = buf;
+    dl.size = size;
+    dl.len = 0;
+    dl.last = DL_NONE;
+    dl.color_set = false;
+    dl.ovf = false;
+}
+
+/*!
+ * @brief Stop recording of display list
+ * @return Length of recorded list in bytes; 0 if the buffer is overflowed
+ */
+uint16_t ST7735_dl_stop(void) {
+    dl.buf = NULL;
+    return dl.ovf ? 0 : dl.len;
+}
+
+static void dl_play(const uint8_t *list, uint16_t len, bool pgm) {
+    int16_t a[6];
+    uint8_t *args = (uint8_t *)a;
+    uint16_t color = 0;
+    uint8_t op, argc;
+    bool sel = false;
+    int16_t org_x = tft->view.org_x;
+    int16_t org_y = tft->view.org_y;
+
+    /* list is recorded in screen coordinates */
+    tft->view.org_x = 0;
+    tft->view.org_y = 0;
+
+    while (len--) {
+        op = pgm ? pgm_read_byte(list) : *list;
+        list++;
+
+        switch (op) {
+            case DL_COLOR:
+                argc = 2;
+                break;
+            case DL_FILL:
+                argc = 4;
+                break;
+            case DL_LINE:
+            case DL_RECT:
+                argc = 8;
+                break;
+            case DL_CIRCLE_B:
+            case DL_CIRCLE_M:
+            case DL_FILL_CIRCLE_B:
+            case DL_FILL_CIRCLE_M:
+                argc = 6;
+                break;
+            case DL_TRIANGLE:
+            case DL_FILL_TRIANGLE:
+                argc = 12;
+                break;
+            default:
+                /* broken list */
+                len = 0;
+                continue;
+        }
+        if (argc > len)
+            break;
+        len -= argc;
+        if (pgm)
+            memcpy_P(args, list, argc);
+        else
+            memcpy(args, list, argc);
+        list += argc;
+
+        if (op == DL_FILL) {
+            /* consecutive fills are sent in one selection */
+            if (!sel) {
+                tft_sel();
+                sel = true;
+            }
+            set_addr_window(args[0], args[1], args[2], args[3]);
+            write_color(color, args[2] * args[3]);
+            continue;
+        }
+        if (sel) {
+            tft_desel();
+            sel = false;
+        }
+
+        switch (op) {
+            case DL_COLOR:
+                color = args[0] | (args[1] << 8);
+                break;
+            case DL_LINE:
+                ST7735_draw_line(a[0], a[1], a[2], a[3], color);
+                break;
+            case DL_RECT:
+                ST7735_draw_rect(a[0], a[1], a[2], a[3], color);
+                break;
+            case DL_CIRCLE_B:
+                ST7735_draw_circle_Bres(a[0], a[1], a[2], color);
+                break;
+            case DL_CIRCLE_M:
+                ST7735_draw_circle_Mich(a[0], a[1], a[2], color);
+                break;
+            case DL_FILL_CIRCLE_B:
+                ST7735_draw_fill_circle_Bres(a[0], a[1], a[2], color);
+                break;
+            case DL_FILL_CIRCLE_M:
+                ST7735_draw_fill_circle_Mich(a[0], a[1], a[2], color);
+                break;
+            case DL_TRIANGLE:
+                ST7735_draw_triangle(a[0], a[1], a[2], a[3], a[4], a[5], color);
+                break;
+            case DL_FILL_TRIANGLE:
+            default:
+                ST7735_draw_fill_triangle(a[0], a[1], a[2], a[3], a[4], a[5], color);
+                break;
+        }
+    }
+
+    if (sel)
+        tft_desel();
+
+    tft->view.org_x = org_x;
+    tft->view.org_y = org_y;
+}
+
+/*!
+ * @brief Draw a display list from RAM
+ * @param list Display list recorded by \c ST7735_dl_record()
+ * @param len Length of \p list in bytes
+ */
+void ST7735_dl_play(const uint8_t *list, uint16_t len) {
+    dl_play(list, len, false);
+}
+
+/*!
+ * @brief Draw a display list from PROGMEM
+ * @param list Display list recorded by \c ST7735_dl_record()
+ * @param len Length of \p list in bytes
+ */
+void ST7735_dl_play_P(const uint8_t *list, uint16_t len) {
+    dl_play(list, len, true);
 }
+
+#endif  /* TFT_DISPLAY_LIST */
@@ -21,24 +21,294 @@ typedef struct {
     uint8_t val;
 } color_hsv;
 
+/* Frame pacing statistics (with TFT_TICKS defined) */
+typedef struct {
+    uint16_t frames;            // presented frames
+    uint16_t missed;            // missed vsyncs; counted only when TE pulses
+                                // come to ST7735_te_isr(), 0 if TE is polled
+    uint16_t update_time;       // duration of last update in TFT_TICKS()
+    uint16_t max_update_time;   // max duration of update in TFT_TICKS()
+} tft_frame_stats;
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} tft_point;
+
+/* Shape of scene (ST7735_draw_scene()) */
+typedef struct {
+    uint8_t type;       // TFT_SHAPE_*
+    uint16_t color;
+    int16_t x;          // corner; center of circle
+    int16_t y;
+    int16_t w;          // width; radius of circle
+    int16_t h;          // height
+    const char *text;   // string of TFT_SHAPE_TEXT (5x7 font, transparent)
+} tft_shape;
+
+#define TFT_SHAPE_FILL_RECT     0
+#define TFT_SHAPE_RECT          1
+#define TFT_SHAPE_FILL_CIRCLE   2
+#define TFT_SHAPE_TEXT          3
+
+/* Gradient modes (ST7735_fill_gradient()) */
+#define TFT_GRAD_H          0       // left to right
+#define TFT_GRAD_V          1       // top to bottom
+#define TFT_GRAD_D          2       // top-left to bottom-right
+#define TFT_GRAD_RADIAL     3       // center to corners
+#define TFT_GRAD_DITHER     0x80    // ordered dithering
+
+/* Strip chart (ST7735_chart_*()).
+ * Time axis is x in landscape and y in portrait rotations.
+ */
+typedef struct {
+    uint8_t t0;         // first position on time axis
+    uint8_t n;          // number of visible samples
+    uint8_t v0;         // first position on value axis
+    uint8_t vn;         // size of value axis
+    uint8_t pos;        // position of next sample on time axis
+    uint8_t top;        // first panel row of scroll area
+    uint8_t last;       // value axis position of last sample
+    uint8_t prev;       // old history of last sample
+    uint8_t cnt;        // number of drawn samples (up to n)
+    uint8_t *hist;      // value axis positions of samples; may be NULL
+    uint16_t fg;        // trace color
+    uint16_t bg;        // background color
+} tft_chart;
+
+/* Glyph of proportional font */
+typedef struct {
+    uint16_t offset;    // bit offset of bitmap in font bitmap
+    uint8_t width;      // bitmap width
+    uint8_t height;     // bitmap height
+    uint8_t x_adv;      // cursor advance
+    int8_t x_off;       // bitmap position from cursor
+    int8_t y_off;       // bitmap top from baseline (negative above it)
+} tft_glyph;
+
+/* Range of consecutive char codes of proportional font */
+typedef struct {
+    uint8_t first;      // first char code
+    uint8_t last;       // last char code
+    uint16_t glyph;     // glyph index of first char code
+} tft_font_range;
+
+/* Proportional font (ST7735_set_font()). Descriptor and all its tables are
+ * in PROGMEM; bitmaps are packed row by row, MSB first, without padding.
+ * Anti-aliased fonts have 2 or 4 bits of alpha per pixel.
+ * Fonts are made from BDF by tools/bdf2font.py.
+ */
+typedef struct {
+    const uint8_t *bitmap;          // glyph bitmaps
+    const tft_glyph *glyphs;        // glyphs of all ranges
+    const tft_font_range *ranges;   // char ranges, sorted by code
+    uint8_t n_ranges;               // number of ranges
+    uint8_t width;                  // max advance; char cell width [1:32]
+    uint8_t height;                 // line height; char cell height
+    uint8_t ascent;                 // baseline from top of line
+    uint8_t bpp;                    // bits per pixel: 1 (or 0), 2 or 4
+} tft_font;
+
+/* Alignment of ST7735_draw_text() */
+#define TFT_ALIGN_LEFT      0
+#define TFT_ALIGN_CENTER    1
+#define TFT_ALIGN_RIGHT     2
+
+/* Line of text laid out by ST7735_layout_text() */
+typedef struct {
+    uint16_t start;     // offset of first byte in string
+    uint16_t len;       // bytes up to the last visible char
+    int16_t w;          // width in pixels
+} tft_text_line;
+
+/* Max digits of seven-segment number */
+#ifndef TFT_NUMBER_DIGITS
+#define TFT_NUMBER_DIGITS 6
+#endif
+
+/* Seven-segment number (ST7735_number_*()).
+ * Only the segments toggled since the last value are redrawn.
+ */
+typedef struct {
+    int16_t x;          // screen position of first digit
+    int16_t y;
+    uint8_t w;          // digit width
+    uint8_t h;          // digit height
+    uint8_t t;          // segment thickness
+    uint8_t n;          // number of digits
+    uint8_t frac;       // digits after decimal point
+    uint16_t fg;        // segment color
+    uint16_t bg;        // background color
+    uint8_t segs[TFT_NUMBER_DIGITS];    // lit segments of digits
+} tft_number;
+
 color_rgb hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val);
+uint16_t color_blend_565(uint16_t fg, uint16_t bg, uint8_t alpha);
 
 FILE st7735_stream;
 
+/* Device handle */
+typedef struct st7735_dev st7735_dev_t;
+
 /* Convert color:
  * color_565 - RGB to 565 (16bit color, 16bit data)
  * color_666 - RGB to 666 (18bit color, 24bit data)
+ * color_444 - RGB to 444 (12bit color, 16bit data; 2 pixels in 24bit packed data)
+ * rgb565_to_444 - 565 to 444
  */
 
 #define color_565(red, green, blue) ((((red) & 0xF8U) << 8U) | (((green) & 0xFCU) << 3U) | ((blue) >> 3U))
 #define color_666(red, green, blue) ((((red) & 0xFCU) << 16U) | (((green) & 0xFCU) << 8U) | ((blue) & 0xFCU))
+#define color_444(red, green, blue) ((((red) & 0xF0U) << 4U) | ((green) & 0xF0U) | ((blue) >> 4U))
+#define rgb565_to_444(c) ((((c) >> 4U) & 0xF00U) | (((c) >> 3U) & 0x0F0U) | (((c) >> 1U) & 0x00FU))
 
+/* Panel geometry (in portrait).
+ * TFT_WIDTH, TFT_HEIGHT - panel size in pixels (128x160, 128x128, 80x160).
+ * TFT_COL_OFFSET, TFT_ROW_OFFSET - position of panel in display memory
+ * (e.g. 2 and 1 for 128x128, 26 and 1 for 80x160 modules).
+ * TFT_GRAM_WIDTH, TFT_GRAM_HEIGHT - size of display memory, that is
+ * used for offsets in mirrored rotations. Panel is centered by default.
+ * TFT_ROTATION - define to fix rotation [0:3]. Screen size and offsets
+ * are constants then, and ST7735_set_rotation() is not available.
+ */
+#ifndef TFT_WIDTH
 #define TFT_WIDTH 128
+#endif
+#ifndef TFT_HEIGHT
 #define TFT_HEIGHT 160
+#endif
+#ifndef TFT_COL_OFFSET
+#define TFT_COL_OFFSET 0
+#endif
+#ifndef TFT_ROW_OFFSET
+#define TFT_ROW_OFFSET 0
+#endif
+#ifndef TFT_GRAM_WIDTH
+#define TFT_GRAM_WIDTH (TFT_WIDTH + 2 * TFT_COL_OFFSET)
+#endif
+#ifndef TFT_GRAM_HEIGHT
+#define TFT_GRAM_HEIGHT (TFT_HEIGHT + 2 * TFT_ROW_OFFSET)
+#endif
 
 #define TFT_WRITE_FREQ 15151515U
 #define TFT_READ_FREQ   6666666U
 
+/* Asynchronous transfers.
+ * Define TFT_ASYNC_SPI to put all transfers to the display into a queue
+ * that is sent from the SPI interrupt, so drawing functions return
+ * immediately (unless the queue is full). Use ST7735_wait_idle() to sync.
+ * Each byte costs one interrupt, so the SPI clock should be low enough
+ * to leave CPU time between them. The SPI bus must not be used by other
+ * devices until ST7735_wait_idle() returns. Several displays (TFT_DEVICES)
+ * share one queue, so drawing to another display does not wait for it.
+ * TFT_QUEUE_SIZE - queue size in bytes (power of 2 in range [16:256]).
+ */
+#ifndef TFT_QUEUE_SIZE
+#define TFT_QUEUE_SIZE 64
+#endif
+
+/* Several displays.
+ * TFT_DEVICES - number of displays on the SPI bus. All functions draw
+ * to the device chosen by ST7735_select(); each display has own CS pin
+ * and state (rotation, cursor, colors, etc.). With a single device
+ * the selected device is a constant, so there is no extra cost.
+ * Panel geometry above is the default of every display; a display of
+ * another size is set by ST7735_set_panel() after its ST7735_init().
+ * CS pins of all displays must be set high before the first ST7735_init().
+ */
+#ifndef TFT_DEVICES
+#define TFT_DEVICES 1
+#endif
+
+/* TFT_PIXELS_BUF - points of ST7735_draw_pixels() sorted at once
+ * (on stack, 3 bytes per point).
+ */
+#ifndef TFT_PIXELS_BUF
+#define TFT_PIXELS_BUF 32
+#endif
+
+/* UTF-8 text.
+ * By default bytes above ASCII are printed as CP437 glyphs.
+ * Define TFT_UTF8 to decode them as UTF-8 in char mode of the stream
+ * (ST7735_symbol_text(false)) and by text functions; characters are
+ * printed by their CP437 glyphs. Symbol mode still prints raw bytes.
+ * TFT_UTF8_REPL - CP437 glyph printed for malformed UTF-8 sequences
+ * and characters missing in CP437.
+ */
+#ifndef TFT_UTF8_REPL
+#define TFT_UTF8_REPL '?'
+#endif
+
+/* TFT_POLY_MAX - max vertices of ST7735_draw_fill_polygon()
+ * (on stack, 13 bytes per vertex).
+ */
+#ifndef TFT_POLY_MAX
+#define TFT_POLY_MAX 16
+#endif
+
+/* TFT_SCENE_BUF - size of row buffer of ST7735_draw_scene() in pixels
+ * (on stack, 2 bytes per pixel). Wider scenes are drawn by strips.
+ */
+#ifndef TFT_SCENE_BUF
+#define TFT_SCENE_BUF 64
+#endif
+
+/* TFT_COPY_BUF - size of bounce buffer of ST7735_copy_rect() in pixels
+ * (on stack, 2 bytes per pixel), at most 255.
+ */
+#ifndef TFT_COPY_BUF
+#define TFT_COPY_BUF 32
+#endif
+#if (TFT_COPY_BUF < 1) || (TFT_COPY_BUF > 255)
+#error "TFT_COPY_BUF must be in range [1:255]"
+#endif
+
+/* TFT_CLIP_DEPTH - max nesting of ST7735_push_viewport()
+ * (in device state, 12 bytes per level).
+ */
+#ifndef TFT_CLIP_DEPTH
+#define TFT_CLIP_DEPTH 4
+#endif
+
+/* Init delays (ms), datasheet minimums.
+ * TFT_RESET_WAIT - after hardware reset. 5 ms is enough, if display is
+ * in sleep mode at reset (powered up with MCU); 120 ms otherwise.
+ * TFT_SLPOUT_WAIT - after Sleep Out, before next command.
+ */
+#ifndef TFT_RESET_WAIT
+#define TFT_RESET_WAIT 120
+#endif
+#ifndef TFT_SLPOUT_WAIT
+#define TFT_SLPOUT_WAIT 5
+#endif
+
+/* Tearing effect sync.
+ * TFT_TE_TIMEOUT - max time of waiting for TE pulse in ms.
+ * TFT_LINE_US, TFT_PORCH_LINES - scan time of one row in us and rows of
+ * V-blanking. Defaults are of FRMCTR1 reset values: 850 kHz / (2 * 5 + 40)
+ * per row, 60 + 60 + 2 porch rows (60 Hz refresh of 160 rows).
+ * TFT_TE_DELAY - delay in us from TE pulse (start of V-blanking) to the
+ * start of frame update. By default the update starts right behind the scan
+ * of the top rows: it must be slower than the scan (as a full row of SPI
+ * write is) and shorter than a refresh period. With 0 the update starts
+ * ahead of the scan and must be faster than the scan.
+ * TFT_TICKS() - time source for frame statistics, returning uint16_t
+ * (e.g. millis() or timer counter). ST7735_frame_stats() is available
+ * only when it is defined.
+ */
+#ifndef TFT_TE_TIMEOUT
+#define TFT_TE_TIMEOUT 50
+#endif
+#ifndef TFT_LINE_US
+#define TFT_LINE_US 59
+#endif
+#ifndef TFT_PORCH_LINES
+#define TFT_PORCH_LINES 122
+#endif
+#ifndef TFT_TE_DELAY
+#define TFT_TE_DELAY ((TFT_PORCH_LINES + 2) * TFT_LINE_US)
+#endif
+
 /* System function Command List
  *     Undefined commands are treated as NOP (00 h) command.
  *     Commands 10h, 12h, 13h, 20h, 21h, 26h, 28h, 29h, 30h, 36h (ML parameter only),
@@ -75,9 +345,11 @@ FILE st7735_stream;
 #define ST7735_RAMWR        0x2C    // Memory write
 #define ST7735_RAMRD        0x2E    // Memory read
 #define ST7735_PTLAR        0x30    // Partial start/end address set
+#define ST7735_SCRLAR       0x33    // Scroll area set
 #define ST7735_TEOFF        0x34    // Tearing effect line off
 #define ST7735_TEON         0x35    // Tearing effect mode set & on
 #define ST7735_MADCTL       0x36    // Memory data access control
+#define ST7735_VSCSAD       0x37    // Vertical scroll start address of RAM
 #define ST7735_IDMOFF       0x38    // Idle mode off
 #define ST7735_IDMON        0x39    // Idle mode on
 #define ST7735_COLMOD       0x3A    // Interface pixel format
@@ -109,8 +381,16 @@ FILE st7735_stream;
 #define ST7735_EXTCTRL      0xF0    // Extension Command Control
 #define ST7735_VCOM4L       0xFF    // Vcom 4 Level control
 
-#define TFT_CURSOR_MAX_C 21     // max columns
-#define TFT_CURSOR_MAX_R 20     // max rows
+/* MADCTL bits */
+#define TFT_MADCTL_MY  0x80     // Row address order
+#define TFT_MADCTL_MX  0x40     // Column address order
+#define TFT_MADCTL_MV  0x20     // Row/Column exchange
+#define TFT_MADCTL_ML  0x10     // Vertical refresh order
+#define TFT_MADCTL_BGR 0x08     // BGR order
+#define TFT_MADCTL_MH  0x04     // Horizontal refresh order
+
+#define TFT_CURSOR_MAX_C (TFT_WIDTH / 6)     // max columns (in portrait)
+#define TFT_CURSOR_MAX_R (TFT_HEIGHT / 8)    // max rows (in portrait)
 
 /* flags */
 #define TFT_TRANSP_TEXT 1U  // transparent pad
@@ -119,16 +399,53 @@ FILE st7735_stream;
 #define TFT_SYM_TEXT 4U     // symbols or char printed
 
 
+st7735_dev_t *ST7735_get_dev(uint8_t num);
+void ST7735_select(st7735_dev_t *dev);
+st7735_dev_t *ST7735_selected(void);
+#if TFT_DEVICES > 1
+void ST7735_set_panel(uint8_t width, uint8_t height, uint8_t col_off, uint8_t row_off);
+#endif
+
 void ST7735_init(uint8_t cs_num, volatile uint8_t *cs_port,
                  uint8_t a0_num, volatile uint8_t *a0_port,
                  uint8_t rst_num, volatile uint8_t *rst_port);
+uint8_t ST7735_init_begin(uint8_t cs_num, volatile uint8_t *cs_port,
+                          uint8_t a0_num, volatile uint8_t *a0_port,
+                          uint8_t rst_num, volatile uint8_t *rst_port);
+uint8_t ST7735_init_poll(void);
 
+void ST7735_wait_idle(void);
+void ST7735_te_on(uint8_t te_num, volatile uint8_t *te_port);
+void ST7735_te_off(void);
+void ST7735_te_isr(void);
+void ST7735_te_isr_dev(st7735_dev_t *dev);
+void ST7735_wait_vsync(void);
+void ST7735_frame_begin(void);
+void ST7735_frame_end(void);
+#ifdef TFT_TICKS
+const tft_frame_stats *ST7735_frame_stats(void);
+#endif
 void ST7735_invert_display(bool val);
 void ST7735_idle_mode(bool val);
+void ST7735_color_12bit(bool val);
+#ifndef TFT_ROTATION
+void ST7735_set_rotation(uint8_t rotation);
+#endif
+uint8_t ST7735_get_rotation(void);
+uint8_t ST7735_get_width(void);
+uint8_t ST7735_get_height(void);
+void ST7735_partial_mode(uint8_t y, uint8_t h, bool idle);
+void ST7735_normal_mode(void);
+bool ST7735_push_viewport(int16_t x, int16_t y, int16_t w, int16_t h);
+void ST7735_pop_viewport(void);
+void ST7735_set_clip(int16_t x, int16_t y, int16_t w, int16_t h);
+void ST7735_reset_clip(void);
 void ST7735_fill_screen(uint16_t rgb565);
 void ST7735_draw_HSV(void);
 
 void ST7735_draw_pixel(int16_t x, int16_t y, uint16_t color);
+void ST7735_draw_pixels(const tft_point *pts, uint16_t n, uint16_t color);
+void ST7735_draw_pixels_colors(const tft_point *pts, const uint16_t *colors, uint16_t n);
 void ST7735_draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
 void ST7735_draw_Hline(int16_t x, int16_t y, int16_t w, uint16_t color);
 void ST7735_draw_Vline(int16_t x, int16_t y, int16_t h, uint16_t color);
@@ -140,6 +457,39 @@ void ST7735_draw_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color
 void ST7735_draw_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
 void ST7735_draw_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
 void ST7735_draw_fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void ST7735_draw_fill_polygon(const tft_point *pts, uint8_t n, uint16_t color, bool nonzero);
+
+/* Unchecked primitives (ST7735_draw_*_unchecked()).
+ * They take screen coordinates that must be inside the clip rectangle
+ * and go straight to the window and burst, without sign fixes, clipping
+ * and viewport translation. Define TFT_DEBUG to verify their arguments
+ * by assert().
+ */
+void ST7735_draw_pixel_unchecked(uint8_t x, uint8_t y, uint16_t color);
+void ST7735_draw_Hline_unchecked(uint8_t x, uint8_t y, uint8_t w, uint16_t color);
+void ST7735_draw_Vline_unchecked(uint8_t x, uint8_t y, uint8_t h, uint16_t color);
+void ST7735_draw_rect_unchecked(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint16_t color);
+void ST7735_draw_fill_rect_unchecked(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint16_t color);
+
+uint16_t ST7735_read_pixel(int16_t x, int16_t y);
+bool ST7735_read_rect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint16_t *buf);
+void ST7735_copy_rect(int16_t src_x, int16_t src_y, int16_t w, int16_t h,
+                      int16_t dst_x, int16_t dst_y);
+void ST7735_blend_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color, uint8_t alpha);
+void ST7735_draw_scene(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t bg,
+                       const tft_shape *shapes, uint8_t n);
+void ST7735_fill_gradient(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t radius,
+                          uint16_t c0, uint16_t c1, uint8_t mode);
+
+void ST7735_chart_init(tft_chart *ch, int16_t x, int16_t y, uint8_t w, uint8_t h,
+                       uint16_t fg, uint16_t bg, uint8_t *hist);
+void ST7735_chart_add(tft_chart *ch, uint8_t v);
+void ST7735_chart_stop(void);
+
+void ST7735_number_init(tft_number *nm, int16_t x, int16_t y, uint8_t n, uint8_t frac,
+                        uint8_t w, uint8_t h, uint8_t t, uint16_t fg, uint16_t bg);
+void ST7735_number_set(tft_number *nm, int32_t value);
 
 void ST7735_set_cursor(int16_t x, int16_t y);
 int16_t ST7735_get_cursor(void);
@@ -152,8 +502,29 @@ void ST7735_transp_text(bool mode);
 void ST7735_wrap_text(bool mode);
 void ST7735_pix_text(bool mode);
 void ST7735_symbol_text(bool mode);
+void ST7735_text_scale(uint8_t scale);
+bool ST7735_set_font(const tft_font *font);
 
+void ST7735_draw_glyph_aa(int16_t x, int16_t y, uint8_t w, uint8_t h,
+                          const uint8_t *glyph, uint8_t bpp);
 int ST7735_put_char(char c, FILE *stream);
+int16_t ST7735_text_width(const char *s, uint16_t len);
+uint8_t ST7735_layout_text(const char *s, int16_t w, tft_text_line *lines, uint8_t max);
+void ST7735_text_bounds(const char *s, int16_t w, int16_t *bw, int16_t *bh);
+void ST7735_draw_text(int16_t x, int16_t y, int16_t w, const char *s, uint8_t align);
+FILE *ST7735_get_stream(void);
 void ST7735_set_stdout();
 
+#ifdef TFT_DISPLAY_LIST
+/* Display lists.
+ * Define TFT_DISPLAY_LIST to record drawing calls into a compact
+ * bytecode list, that can be kept in RAM or PROGMEM and replayed.
+ * Little-endian, so lists are portable between AVR targets only.
+ */
+void ST7735_dl_record(uint8_t *buf, uint16_t size);
+uint16_t ST7735_dl_stop(void);
+void ST7735_dl_play(const uint8_t *list, uint16_t len);
+void ST7735_dl_play_P(const uint8_t *list, uint16_t len);
+#endif
+
 #endif  /* !ST7735_H */
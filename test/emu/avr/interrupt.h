@@ -0,0 +1,11 @@
+#ifndef EMU_AVR_INTERRUPT_H
+#define EMU_AVR_INTERRUPT_H
+
+void emu_cli(void);
+void emu_sei(void);
+
+#define cli() emu_cli()
+#define sei() emu_sei()
+#define ISR(vector, ...) void vector(void)
+
+#endif  /* !EMU_AVR_INTERRUPT_H */
@@ -0,0 +1,39 @@
+/* Registers of ATmega used by the driver, emulated by emu.c */
+#ifndef EMU_AVR_IO_H
+#define EMU_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(b) (1U << (b))
+#define bit_is_set(reg, b) ((reg) & _BV(b))
+
+/* I/O ports in AVR order: PINx, DDRx, PORTx */
+extern volatile uint8_t emu_io[9];
+#define PINB (emu_io[0])
+#define DDRB (emu_io[1])
+#define PORTB (emu_io[2])
+#define PINC (emu_io[3])
+#define DDRC (emu_io[4])
+#define PORTC (emu_io[5])
+#define PIND (emu_io[6])
+#define DDRD (emu_io[7])
+#define PORTD (emu_io[8])
+
+/* Status register is shared with the interrupt thread. Its accessor
+ * lets the thread run while the driver polls in a loop
+ */
+volatile _Atomic uint8_t *emu_sreg(void);
+#define SREG (*emu_sreg())
+#define SREG_I 7
+
+/* SPI. SPDR and SPSR accesses drive the transfer like the hardware does */
+volatile uint8_t *emu_spcr(void);
+volatile _Atomic int16_t *emu_spdr(void);
+volatile uint8_t *emu_spsr(void);
+#define SPCR (*emu_spcr())
+#define SPDR (*emu_spdr())
+#define SPSR (*emu_spsr())
+#define SPIE 7
+#define SPIF 7
+
+#endif  /* !EMU_AVR_IO_H */
@@ -0,0 +1,17 @@
+#ifndef EMU_AVR_PGMSPACE_H
+#define EMU_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Program memory is ordinary memory on the host */
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#endif  /* !EMU_AVR_PGMSPACE_H */
@@ -0,0 +1,11 @@
+/* Bit macros of defines-avr */
+#ifndef EMU_DEFINES_H
+#define EMU_DEFINES_H
+
+#define bit_set(reg, bit) ((reg) |= _BV(bit))
+#define bit_clear(reg, bit) ((reg) &= ~_BV(bit))
+#define bit_write(reg, bit, val) ((val) ? bit_set(reg, bit) : bit_clear(reg, bit))
+#define set_output(ddr, bit) bit_set(ddr, bit)
+#define set_input(ddr, bit) bit_clear(ddr, bit)
+
+#endif  /* !EMU_DEFINES_H */
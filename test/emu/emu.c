@@ -0,0 +1,524 @@
+/* Host emulator of ST7735 displays on the SPI bus of ATmega */
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <spi.h>
+
+#include "emu.h"
+
+#define CS0_PORT (emu_io[2])    // PORTB
+#define CS0_PIN 2
+#define CS1_PORT (emu_io[8])    // PORTD
+#define CS1_PIN 2
+#define A0_PORT (emu_io[2])
+#define A0_PIN 1
+#define TE_PINS (emu_io[6])     // PIND
+
+#define SPEED_READ 6666666U
+
+volatile uint8_t emu_io[9];
+static volatile _Atomic uint8_t sreg;
+
+struct emu_panel emu_panels[EMU_PANELS];
+
+long emu_bytes;
+long emu_bad_cmds;
+long emu_bus_errors;
+long emu_read_bytes;
+long emu_fast_reads;
+long emu_speed_changes;
+uint32_t emu_speed;
+
+double emu_us;
+double emu_byte_us;
+double emu_line_us = 59;
+int emu_porch_lines = 122;
+
+int emu_failures;
+
+/* SPI interrupt of the driver */
+void SPI_STC_vect(void) __attribute__((weak));
+void SPI_STC_vect(void) {}
+
+static pthread_mutex_t hw_lock;
+static volatile _Atomic int16_t spdr = -1;  // byte being sent; -1 if none
+static uint8_t spdr_pins;       // CS and A0 when it was written
+static volatile uint8_t spcr;
+static volatile uint8_t spsr;
+static volatile _Atomic bool spif;
+static volatile _Atomic bool isr_running;
+static volatile _Atomic bool isr_run;
+static pthread_t isr_thread;
+static unsigned isr_seed;
+
+__attribute__((constructor)) static void emu_setup(void) {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&hw_lock, &attr);
+    emu_reset();
+}
+
+static inline void lock(void) {
+    pthread_mutex_lock(&hw_lock);
+}
+
+static inline void unlock(void) {
+    pthread_mutex_unlock(&hw_lock);
+}
+
+static inline bool in_isr(void) {
+    return isr_run && pthread_equal(pthread_self(), isr_thread);
+}
+
+/* Let the main thread run in the middle of the interrupt */
+static void isr_preempt(void) {
+    if (in_isr() && !(rand_r(&isr_seed) & 3)) {
+        unlock();
+        sched_yield();
+        lock();
+    }
+}
+
+/* Period of panel refresh in us */
+static double frame_us(void) {
+    return (EMU_ROWS + emu_porch_lines) * emu_line_us;
+}
+
+/* Advance time; TE is high in V-blanking */
+static void advance(double us) {
+    double t;
+
+    lock();
+    emu_us += us;
+    t = fmod(emu_us, frame_us());
+    if (t >= EMU_ROWS * emu_line_us)
+        TE_PINS |= _BV(EMU_TE_PIN);
+    else
+        TE_PINS &= ~_BV(EMU_TE_PIN);
+    unlock();
+}
+
+/* The interrupt thread runs during delays */
+void _delay_ms(double ms) {
+    advance(ms * 1000);
+    if (isr_run && !in_isr())
+        sched_yield();
+}
+
+void _delay_us(double us) {
+    advance(us);
+    if (isr_run && !in_isr())
+        sched_yield();
+}
+
+/*!
+ * @brief Index of the first refresh that scans the row after a time
+ * @param t Time in us
+ * @param row Row of display memory
+ */
+long emu_refresh(double t, uint16_t row) {
+    return (long)ceil((t - row * emu_line_us) / frame_us());
+}
+
+void emu_reset(void) {
+    lock();
+    memset(emu_panels, 0, sizeof(emu_panels));
+    for (uint8_t i = 0; i < EMU_PANELS; i++) {
+        struct emu_panel *p = &emu_panels[i];
+
+        p->cmd = 0;
+        p->colmod = 6;
+        p->xe = 131;
+        p->ye = 161;
+        p->vsa = 162;
+    }
+    emu_bytes = emu_bad_cmds = emu_bus_errors = 0;
+    emu_read_bytes = emu_fast_reads = emu_speed_changes = 0;
+    emu_us = 0;
+    unlock();
+}
+
+/* Selected panel; NULL (and bus error) if there is not exactly one */
+static struct emu_panel *selected(void) {
+    bool s0 = !(CS0_PORT & _BV(CS0_PIN));
+    bool s1 = !(CS1_PORT & _BV(CS1_PIN));
+
+    if (s0 == s1) {
+        emu_bus_errors++;
+        return NULL;
+    }
+    return s0 ? &emu_panels[0] : &emu_panels[1];
+}
+
+static uint8_t pins(void) {
+    return (!!(CS0_PORT & _BV(CS0_PIN))) | (!!(CS1_PORT & _BV(CS1_PIN)) << 1) |
+           (!!(A0_PORT & _BV(A0_PIN)) << 2);
+}
+
+static void next_px(struct emu_panel *p) {
+    if (++p->x > p->xe) {
+        p->x = p->xs;
+        if (++p->y > p->ye)
+            p->y = p->ys;
+    }
+}
+
+static void put_px(struct emu_panel *p, uint32_t px) {
+    if (p->x < EMU_GRAM_SIZE && p->y < EMU_GRAM_SIZE) {
+        p->gram[p->y][p->x] = px;
+        p->row_time[p->y] = emu_us;
+    } else {
+        emu_bus_errors++;
+    }
+    next_px(p);
+}
+
+static uint32_t px444(uint16_t c) {
+    uint32_t r = (c >> 8) & 0xF, g = (c >> 4) & 0xF, b = c & 0xF;
+
+    return (((r << 2) | (r >> 2)) << 12) | (((g << 2) | (g >> 2)) << 6) | ((b << 2) | (b >> 2));
+}
+
+static bool known_cmd(uint8_t cmd) {
+    static const uint8_t cmds[] = {
+        0x00, 0x01, 0x04, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x10, 0x11, 0x12, 0x13,
+        0x20, 0x21, 0x26, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x30, 0x33, 0x34,
+        0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0xB1, 0xB2, 0xB3, 0xB4, 0xB6, 0xC0, 0xC1,
+        0xC2, 0xC3, 0xC4, 0xC5, 0xC7, 0xD1, 0xD2, 0xD9, 0xDA, 0xDB, 0xDC, 0xDE, 0xDF,
+        0xE0, 0xE1, 0xF0, 0xFC, 0xFF
+    };
+
+    return memchr(cmds, cmd, sizeof(cmds)) != NULL;
+}
+
+static void command(struct emu_panel *p, uint8_t cmd) {
+    p->cmd = cmd;
+    p->nargs = 0;
+    p->px_n = 0;
+    p->cmds[cmd]++;
+    if (!known_cmd(cmd))
+        emu_bad_cmds++;
+    switch (cmd) {
+        case 0x12: p->partial = true; break;
+        case 0x13: p->partial = false; break;
+        case 0x20: p->inverted = false; break;
+        case 0x21: p->inverted = true; break;
+        case 0x38: p->idle = false; break;
+        case 0x39: p->idle = true; break;
+        case 0x2C:
+        case 0x2E:
+            p->x = p->xs;
+            p->y = p->ys;
+            p->rd_n = 0;
+            break;
+    }
+}
+
+static void data(struct emu_panel *p, uint8_t b) {
+    uint8_t n = (p->colmod == 5) ? 2 : 3;
+    uint16_t a, c;
+
+    if (p->cmd == 0x2C) {
+        p->px[p->px_n++] = b;
+        /* 12-bit pixel is written when its bits are received */
+        if (p->colmod == 3 && p->px_n == 2)
+            put_px(p, px444((p->px[0] << 4) | (p->px[1] >> 4)));
+        if (p->px_n < n)
+            return;
+        p->px_n = 0;
+        if (p->colmod == 5) {
+            put_px(p, emu_565_to_18((p->px[0] << 8) | p->px[1]));
+        } else if (p->colmod == 3) {
+            put_px(p, px444(((p->px[1] & 0xF) << 8) | p->px[2]));
+        } else {
+            put_px(p, ((uint32_t)(p->px[0] >> 2) << 12) | ((p->px[1] >> 2) << 6) | (p->px[2] >> 2));
+        }
+        return;
+    }
+
+    if (p->nargs < sizeof(p->args))
+        p->args[p->nargs++] = b;
+    a = (p->args[0] << 8) | p->args[1];
+    c = (p->args[2] << 8) | p->args[3];
+    switch (p->cmd) {
+        case 0x2A: if (p->nargs == 4) { p->xs = a; p->xe = c; } break;
+        case 0x2B: if (p->nargs == 4) { p->ys = a; p->ye = c; } break;
+        case 0x30: if (p->nargs == 4) { p->ptl_start = a; p->ptl_end = c; } break;
+        case 0x33:
+            if (p->nargs == 6) {
+                p->tfa = a;
+                p->vsa = c;
+                p->bfa = (p->args[4] << 8) | p->args[5];
+            }
+            break;
+        case 0x36: p->madctl = b; break;
+        case 0x37: if (p->nargs == 2) p->vscsad = a; break;
+        case 0x3A: p->colmod = b & 7; break;
+    }
+}
+
+/* Clock a written byte into the selected display */
+static void transfer(uint8_t b) {
+    struct emu_panel *p = selected();
+
+    emu_bytes++;
+    emu_us += emu_byte_us;
+    if (!p)
+        return;
+    if (A0_PORT & _BV(A0_PIN))
+        data(p, b);
+    else
+        command(p, b);
+}
+
+/* Complete the transfer of SPDR */
+static void spi_complete(void) {
+    int16_t b = spdr;
+
+    if (b < 0)
+        return;
+    if (pins() != spdr_pins)
+        emu_bus_errors++;
+    spdr = -1;
+    transfer(b);
+    advance(0);
+    spif = true;
+}
+
+volatile uint8_t *emu_spcr(void) {
+    lock();
+    isr_preempt();
+    unlock();
+    return &spcr;
+}
+
+volatile _Atomic int16_t *emu_spdr(void) {
+    lock();
+    isr_preempt();
+    if (spdr >= 0) {
+        /* write collision */
+        emu_bus_errors++;
+        spi_complete();
+    }
+    spif = false;
+    spdr_pins = pins();
+    unlock();
+    return &spdr;
+}
+
+volatile uint8_t *emu_spsr(void) {
+    lock();
+    spi_complete();
+    spsr = spif ? _BV(SPIF) : 0;
+    unlock();
+    return &spsr;
+}
+
+volatile _Atomic uint8_t *emu_sreg(void) {
+    if (isr_run && !in_isr())
+        sched_yield();
+    return &sreg;
+}
+
+void emu_cli(void) {
+    atomic_fetch_and(&sreg, (uint8_t)~_BV(SREG_I));
+    while (isr_running)
+        sched_yield();
+}
+
+void emu_sei(void) {
+    atomic_fetch_or(&sreg, _BV(SREG_I));
+}
+
+static void *isr_loop(void *arg) {
+    (void)arg;
+    while (isr_run) {
+        /* vary the interleaving with the main thread */
+        unsigned n = rand_r(&isr_seed) & 63;
+
+        if (!n)
+            usleep(1);
+        sched_yield();
+        while (n--) {
+            bool irq;
+
+            isr_running = true;
+            lock();
+            spi_complete();
+            irq = spif && (spcr & _BV(SPIE)) && (sreg & _BV(SREG_I));
+            if (irq)
+                spif = false;
+            unlock();
+            if (irq)
+                SPI_STC_vect();
+            isr_running = false;
+            if (!irq)
+                break;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * @brief Run SPI interrupt on a thread and enable interrupts
+ * @param seed Seed of random delays of the thread
+ */
+static void isr_timeout(int sig) {
+    (void)sig;
+    printf("timeout: transfers stalled\n");
+    _exit(1);
+}
+
+void emu_isr_start(unsigned seed) {
+    /* a lost interrupt leaves the driver waiting forever */
+    signal(SIGALRM, isr_timeout);
+    alarm(60);
+    isr_seed = seed;
+    isr_run = true;
+    pthread_create(&isr_thread, NULL, isr_loop, NULL);
+    sei();
+}
+
+/* Disable interrupts and stop the thread */
+void emu_isr_stop(void) {
+    cli();
+    isr_run = false;
+    pthread_join(isr_thread, NULL);
+}
+
+/* No byte is being sent, SPI interrupt is off and displays are deselected */
+bool emu_spi_idle(void) {
+    bool idle;
+
+    lock();
+    idle = (spdr < 0) && !(spcr & _BV(SPIE)) &&
+           (CS0_PORT & _BV(CS0_PIN)) && (CS1_PORT & _BV(CS1_PIN));
+    unlock();
+    return idle;
+}
+
+/* 16-bit color of pixel of display memory */
+uint16_t emu_px565(uint8_t panel, uint16_t x, uint16_t y) {
+    uint32_t px = emu_panels[panel].gram[y][x];
+
+    return ((px >> 13) << 11) | (((px >> 6) & 0x3F) << 5) | ((px & 0x3F) >> 1);
+}
+
+void spi_set_speed(uint32_t freq) {
+    lock();
+    if (freq != emu_speed)
+        emu_speed_changes++;
+    emu_speed = freq;
+    unlock();
+}
+
+void spi_write(uint8_t data) {
+    lock();
+    spi_complete();
+    transfer(data);
+    advance(0);
+    spif = true;
+    unlock();
+}
+
+void spi_write16(uint16_t data) {
+    spi_write(data >> 8);
+    spi_write(data);
+}
+
+void spi_write24(uint32_t data) {
+    spi_write(data >> 16);
+    spi_write16(data);
+}
+
+void spi_write32(uint32_t data) {
+    spi_write16(data >> 16);
+    spi_write16(data);
+}
+
+void spi_write_buf(uint8_t *buf, size_t count) {
+    while (count--)
+        spi_write(*buf++);
+}
+
+/* Read of RAMRD: a dummy byte, then 3 bytes of 6-bit colors per pixel */
+uint8_t spi_read_8(void) {
+    struct emu_panel *p;
+    uint8_t b = 0;
+
+    lock();
+    emu_read_bytes++;
+    if (emu_speed > SPEED_READ)
+        emu_fast_reads++;
+    emu_us += emu_byte_us;
+    p = selected();
+    if (p && p->cmd == 0x2E && p->rd_n++) {
+        switch ((p->rd_n - 2) % 3) {
+            case 0:
+                p->rd_px = (p->x < EMU_GRAM_SIZE && p->y < EMU_GRAM_SIZE) ?
+                           p->gram[p->y][p->x] : 0;
+                next_px(p);
+                b = (p->rd_px >> 12) << 2;
+                break;
+            case 1:
+                b = ((p->rd_px >> 6) & 0x3F) << 2;
+                break;
+            default:
+                b = (p->rd_px & 0x3F) << 2;
+                break;
+        }
+    }
+    unlock();
+    return b;
+}
+
+/* User data of streams */
+static struct {
+    FILE *stream;
+    void *udata;
+} udata[EMU_PANELS];
+
+void fdev_set_udata(FILE *stream, void *data) {
+    for (uint8_t i = 0; i < EMU_PANELS; i++) {
+        if (!udata[i].stream || udata[i].stream == stream) {
+            udata[i].stream = stream;
+            udata[i].udata = data;
+            return;
+        }
+    }
+}
+
+void *fdev_get_udata(FILE *stream) {
+    for (uint8_t i = 0; i < EMU_PANELS; i++)
+        if (udata[i].stream == stream)
+            return udata[i].udata;
+    return NULL;
+}
+
+uint16_t emu_ticks(void) {
+    return (uint16_t)(emu_us / 1000);
+}
+
+/*!
+ * @brief Report result of test
+ * @return Exit status
+ */
+int emu_done(const char *name) {
+    if (emu_failures) {
+        printf("%s: %d checks failed\n", name, emu_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
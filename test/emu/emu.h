@@ -0,0 +1,99 @@
+/* Host emulator of ST7735 displays on the SPI bus of ATmega.
+ *
+ * Two panels share SPI and A0 (PB1): panel 0 is selected by PB2,
+ * panel 1 by PD2. Display memory is kept in address space
+ * (columns by CASET, rows by RASET), MADCTL is not applied.
+ * The SPI interrupt runs on its own thread after emu_isr_start(),
+ * otherwise the transfer of SPDR completes when SPSR is polled.
+ * Time advances with delays and transferred bytes; the TE output
+ * (PD3) follows the scan of the panel.
+ */
+#ifndef EMU_H
+#define EMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define EMU_PANELS 2
+#define EMU_GRAM_SIZE 162   // max columns and rows of address space
+#define EMU_TE_PIN 3        // TE output on port D
+#define EMU_ROWS 160        // scanned rows
+
+struct emu_panel {
+    uint32_t gram[EMU_GRAM_SIZE][EMU_GRAM_SIZE];   // 18-bit pixels by [row][column]
+    double row_time[EMU_GRAM_SIZE];     // time of last write to each row in us
+    long cmds[256];     // number of received commands
+    uint8_t cmd;        // last command
+    uint8_t args[8];    // received arguments of last command
+    uint8_t nargs;
+    uint16_t xs, xe;    // window
+    uint16_t ys, ye;
+    uint16_t x, y;      // memory pointer
+    uint8_t colmod;
+    uint8_t madctl;
+    bool inverted;
+    bool partial;
+    bool idle;
+    uint16_t ptl_start, ptl_end;        // partial area (PTLAR)
+    uint16_t tfa, vsa, bfa;             // scroll area (SCRLAR)
+    uint16_t vscsad;                    // scroll start (VSCSAD)
+    uint8_t px[3];      // bytes of pixel being written
+    uint8_t px_n;
+    uint32_t rd_n;      // bytes read after RAMRD
+    uint32_t rd_px;     // pixel being read
+};
+
+extern struct emu_panel emu_panels[EMU_PANELS];
+
+extern long emu_bytes;          // bytes written to displays
+extern long emu_bad_cmds;       // unknown commands
+extern long emu_bus_errors;     // bytes without one selected display, pins changed during transfer
+extern long emu_read_bytes;     // bytes read from displays
+extern long emu_fast_reads;     // bytes read faster than TFT_READ_FREQ
+extern long emu_speed_changes;  // changes of SPI speed
+extern uint32_t emu_speed;      // SPI speed
+
+extern double emu_us;           // time in us
+extern double emu_byte_us;      // transfer time of one byte; 0 by default
+extern double emu_line_us;      // scan time of one row
+extern int emu_porch_lines;     // rows of V-blanking
+
+extern int emu_failures;
+
+/* Check condition of test; the message is printed on failure */
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            emu_failures++; \
+            printf("%s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+void emu_reset(void);
+void emu_isr_start(unsigned seed);
+void emu_isr_stop(void);
+bool emu_spi_idle(void);
+uint16_t emu_px565(uint8_t panel, uint16_t x, uint16_t y);
+long emu_refresh(double t, uint16_t row);
+int emu_done(const char *name);
+
+/* Expand 16-bit color to pixel of display memory */
+static inline uint32_t emu_565_to_18(uint16_t c) {
+    uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+
+    return (((r << 1) | (r >> 4)) << 12) | (g << 6) | ((b << 1) | (b >> 4));
+}
+
+/* 16-bit color of display memory written in 12-bit mode */
+static inline uint16_t emu_444_to_565(uint16_t c) {
+    uint16_t r = (c >> 8) & 0xF, g = (c >> 4) & 0xF, b = c & 0xF;
+
+    r = (r << 2) | (r >> 2);
+    g = (g << 2) | (g >> 2);
+    b = (b << 2) | (b >> 2);
+    return ((r >> 1) << 11) | (g << 5) | (b >> 1);
+}
+
+#endif  /* !EMU_H */
@@ -0,0 +1,17 @@
+/* Included before every source of host tests: avr-libc stdio extensions */
+#ifndef EMU_HOST_H
+#define EMU_HOST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define _FDEV_SETUP_WRITE 2
+#define fdev_setup_stream(stream, put, get, rwflag) ((void)(stream), (void)(put))
+
+void fdev_set_udata(FILE *stream, void *udata);
+void *fdev_get_udata(FILE *stream);
+
+/* Emulated time in 100 us for TFT_TICKS() */
+uint16_t emu_ticks(void);
+
+#endif  /* !EMU_HOST_H */
@@ -0,0 +1,30 @@
+/* Interface of spi-avr; transfers go to the emulated displays */
+#ifndef EMU_SPI_H
+#define EMU_SPI_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct pin_s {
+    uint8_t pin_num;
+    volatile uint8_t *port;
+};
+
+struct spi_device_s {
+    struct pin_s cs;
+    struct pin_s a0;
+    struct pin_s rst;
+    struct pin_s intr;
+};
+
+#define SPI_MOSI 3
+
+void spi_set_speed(uint32_t freq);
+void spi_write(uint8_t data);
+void spi_write16(uint16_t data);
+void spi_write24(uint32_t data);
+void spi_write32(uint32_t data);
+void spi_write_buf(uint8_t *buf, size_t count);
+uint8_t spi_read_8(void);
+
+#endif  /* !EMU_SPI_H */
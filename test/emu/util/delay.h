@@ -0,0 +1,8 @@
+#ifndef EMU_UTIL_DELAY_H
+#define EMU_UTIL_DELAY_H
+
+/* Delays advance the emulated time */
+void _delay_ms(double ms);
+void _delay_us(double us);
+
+#endif  /* !EMU_UTIL_DELAY_H */
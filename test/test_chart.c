@@ -0,0 +1,90 @@
+/* Strip chart: every line of the time axis holds the trace from the sample
+ * before it, and adding a sample erases only the old trace of its line.
+ */
+#include <stdlib.h>
+
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define X 10        // chart area in portrait: time axis is y
+#define Y 20
+#define W 100
+#define H 60
+
+#define FG 0xFFFF
+#define BG 0x0000
+#define MARK 0x07E0 // pixels out of trace, which must not be erased
+
+#define SAMPLES (3 * H)
+
+static uint8_t samples[SAMPLES];
+
+/* Columns of trace of sample s: from the sample before it, a dot for the first */
+static void trace(int s, int *a, int *b) {
+    *a = samples[s];
+    *b = s ? samples[s - 1] : samples[s];
+    if (*a > *b) {
+        int tmp = *a;
+        *a = *b;
+        *b = tmp;
+    }
+}
+
+/* Check line t with trace of sample s; pixels of trace of sample old
+ * (if any) may be erased, others must keep the mark
+ */
+static int check_line(int t, int s, int old) {
+    int a, b, oa = 0, ob = -1;
+    int errors = 0;
+
+    trace(s, &a, &b);
+    if (old >= 0)
+        trace(old, &oa, &ob);
+    for (int x = 0; x < W; x++) {
+        uint16_t c = emu_px565(0, X + x, Y + t);
+        bool ok;
+
+        if ((x >= a) && (x <= b))
+            ok = (c == FG);
+        else
+            ok = (c == MARK) || ((c == BG) && (x >= oa) && (x <= ob));
+        if (!ok && !errors++)
+            CHECK(0, "line %d column %d: %04X", t, x, c);
+    }
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    tft_chart ch;
+    uint8_t hist[H];
+
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+    ST7735_chart_init(&ch, X, Y, W, H, FG, BG, hist);
+
+    srand(4);
+    for (int n = 0; n < SAMPLES; n++) {
+        /* mark background, so erasing past the old trace is seen */
+        ST7735_wait_idle();
+        for (int y = 0; y < H; y++)
+            for (int x = 0; x < W; x++)
+                if (emu_px565(0, X + x, Y + y) == BG)
+                    emu_panels[0].gram[Y + y][X + x] = emu_565_to_18(MARK);
+
+        samples[n] = rand() % W;
+        ST7735_chart_add(&ch, samples[n]);
+        ST7735_wait_idle();
+
+        /* line of every drawn sample, the new one replaces sample n - H */
+        for (int s = (n >= H) ? n - H + 1 : 0; s <= n; s++)
+            CHECK(!check_line(s % H, s, (s == n && n >= H) ? n - H : -1), "sample %d", n);
+    }
+
+    CHECK(!emu_bad_cmds, "%ld unknown commands", emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+    return emu_done(argv[0]);
+}
@@ -0,0 +1,95 @@
+/* Anti-aliased glyphs: alpha of 2 and 4 bpp maps, big glyphs (bit offset
+ * past 16 bits), unsupported bpp, and transparent mode over read back pixels.
+ */
+#include <string.h>
+
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define BIG_W 200
+#define BIG_H 150
+#define BIG_X (-40)
+
+static uint8_t glyph[BIG_W * BIG_H * 4 / 8];
+
+/* Alpha map of w x h with value of pixel (x + y) */
+static void make_glyph(uint8_t w, uint8_t h, uint8_t bpp) {
+    uint8_t mask = (1U << bpp) - 1;
+
+    memset(glyph, 0, sizeof(glyph));
+    for (uint32_t i = 0; i < (uint32_t)w * h; i++) {
+        uint32_t bit = i * bpp;
+        uint8_t v = (i % w + i / w) & mask;
+
+        glyph[bit >> 3] |= v << (8 - bpp - (bit & 7));
+    }
+}
+
+/* Expected color of alpha value */
+static uint16_t expected(uint16_t fg, uint16_t bg, uint8_t v, uint8_t bpp) {
+    uint8_t max = (1U << bpp) - 1;
+
+    return color_blend_565(fg, bg, (v * 64 + max) / (2 * max));
+}
+
+/* Compare w x h pixels at x0, y0 to glyph from its column gx */
+static int diff_glyph(int x0, int y0, uint8_t gx, uint8_t w, uint8_t h, uint8_t bpp,
+                      uint16_t fg, uint16_t bg) {
+    uint8_t mask = (1U << bpp) - 1;
+    int errors = 0;
+
+    ST7735_wait_idle();
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint16_t c = expected(fg, bg, (gx + x + y) & mask, bpp);
+
+            if ((emu_px565(0, x0 + x, y0 + y) != c) && !errors++)
+                CHECK(0, "%u bpp: pixel (%d,%d) %04X, expected %04X", bpp, x, y,
+                      emu_px565(0, x0 + x, y0 + y), c);
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+    ST7735_set_text_color(0xFFE0);
+    ST7735_set_text_bg_color(0x0010);
+
+    /* 4 bpp map of 120 Kbit, clipped on the left */
+    make_glyph(BIG_W, BIG_H, 4);
+    ST7735_draw_glyph_aa(BIG_X, 0, BIG_W, BIG_H, glyph, 4);
+    CHECK(!diff_glyph(0, 0, -BIG_X, TFT_WIDTH, BIG_H, 4, 0xFFE0, 0x0010), "big 4 bpp glyph");
+
+    make_glyph(20, 10, 2);
+    ST7735_draw_glyph_aa(3, 150, 20, 10, glyph, 2);
+    CHECK(!diff_glyph(3, 150, 0, 20, 10, 2, 0xFFE0, 0x0010), "2 bpp glyph");
+
+    /* nothing is drawn with other bpp */
+    for (uint8_t bpp = 0; bpp < 9; bpp++) {
+        long bytes = emu_bytes;
+
+        if (bpp == 2 || bpp == 4)
+            continue;
+        memset(glyph, 0xFF, sizeof(glyph));
+        ST7735_draw_glyph_aa(0, 0, 8, 8, glyph, bpp);
+        ST7735_wait_idle();
+        CHECK(emu_bytes == bytes, "%u bpp glyph is drawn", bpp);
+    }
+
+    /* transparent glyph is blended over display memory */
+    ST7735_draw_fill_rect(30, 150, 20, 10, 0xF800);
+    ST7735_transp_text(true);
+    make_glyph(20, 10, 4);
+    ST7735_draw_glyph_aa(30, 150, 20, 10, glyph, 4);
+    CHECK(!diff_glyph(30, 150, 0, 20, 10, 4, 0xFFE0, 0xF800), "transparent glyph");
+
+    CHECK(!emu_bad_cmds, "%ld unknown commands", emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+    return emu_done(argv[0]);
+}
@@ -0,0 +1,62 @@
+/* Drawing in partial mode is clipped to the partial area (a band of panel
+ * rows) in all rotations.
+ */
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define PTL_Y 40
+#define PTL_H 30
+
+/* Panel row of a pixel of display memory in rotation (no offsets) */
+static int panel_row(uint8_t rot, int x, int y) {
+    switch (rot) {
+        case 0: return y;
+        case 1: return x;
+        case 2: return TFT_HEIGHT - 1 - y;
+        default: return TFT_HEIGHT - 1 - x;
+    }
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+
+    for (uint8_t rot = 0; rot < 4; rot++) {
+        int16_t w, h;
+        int outside = 0, missing = 0;
+
+        ST7735_set_rotation(rot);
+        w = ST7735_get_width();
+        h = ST7735_get_height();
+        ST7735_fill_screen(0x0000);
+        ST7735_partial_mode(PTL_Y, PTL_H, false);
+        ST7735_fill_screen(0xFFFF);
+        ST7735_draw_line(0, 0, w - 1, h - 1, 0xF800);
+        ST7735_draw_fill_rect(-5, -5, w + 10, 8, 0x07E0);
+        ST7735_normal_mode();
+
+        for (int y = 0; y < TFT_HEIGHT; y++) {
+            for (int x = 0; x < TFT_HEIGHT; x++) {
+                int row = panel_row(rot, x, y);
+                bool in_screen = (x < ((rot & 1) ? TFT_HEIGHT : TFT_WIDTH)) &&
+                                 (y < ((rot & 1) ? TFT_WIDTH : TFT_HEIGHT));
+                bool in_band = (row >= PTL_Y) && (row < PTL_Y + PTL_H);
+
+                if (!in_screen)
+                    continue;
+                if (!in_band && emu_px565(0, x, y))
+                    outside++;
+                if (in_band && !emu_px565(0, x, y))
+                    missing++;
+            }
+        }
+        CHECK(!outside, "rotation %u: %d pixels drawn outside of partial area", rot, outside);
+        CHECK(!missing, "rotation %u: %d pixels of partial area not drawn", rot, missing);
+    }
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+    return emu_done(argv[0]);
+}
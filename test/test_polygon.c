@@ -0,0 +1,120 @@
+/* Filled polygons: coverage of pixel centers by even-odd and non-zero rules
+ * compared to a reference in floating point, with coordinates up to the
+ * range of int16_t and in a viewport.
+ */
+#include <math.h>
+#include <stdlib.h>
+
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define W TFT_WIDTH
+#define H TFT_HEIGHT
+#define EPS 0.01    // pixels closer to an edge may be rounded either way
+
+/* Winding number of pixel center; false if an edge is too close */
+static bool winding(const tft_point *pts, uint8_t n, double px, double py, int *wind) {
+    *wind = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        const tft_point *p0 = &pts[i], *p1 = &pts[(i + 1) % n];
+        double y0 = p0->y, y1 = p1->y;
+
+        if (y0 == y1)
+            continue;
+        if ((py < fmin(y0, y1)) || (py >= fmax(y0, y1)))
+            continue;
+
+        double x = p0->x + (p1->x - (double)p0->x) * (py - y0) / (y1 - y0);
+
+        if (fabs(x - px) < EPS)
+            return false;
+        if (x < px)
+            *wind += (y1 > y0) ? 1 : -1;
+    }
+    return true;
+}
+
+/* Draw polygon in clip rectangle x0, y0, w, h with origin at x0, y0 */
+static int check_polygon(const tft_point *pts, uint8_t n, bool nonzero,
+                         int16_t x0, int16_t y0, int16_t w, int16_t h) {
+    int errors = 0;
+
+    ST7735_fill_screen(0);
+    if (!ST7735_push_viewport(x0, y0, w, h))
+        return 1;
+    ST7735_draw_fill_polygon(pts, n, 0xFFFF, nonzero);
+    ST7735_pop_viewport();
+    ST7735_wait_idle();
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            bool in_clip = (x >= x0) && (x < x0 + w) && (y >= y0) && (y < y0 + h);
+            int wind;
+
+            if (in_clip && !winding(pts, n, x - x0 + 0.5, y - y0 + 0.5, &wind))
+                continue;
+
+            bool inside = in_clip && (nonzero ? (wind != 0) : (wind & 1));
+
+            if ((emu_px565(0, x, y) == 0xFFFF) != inside && !errors++)
+                CHECK(0, "pixel (%d,%d) is %s", x, y, inside ? "not filled" : "filled");
+        }
+    }
+    return errors;
+}
+
+static int16_t random_coord(int16_t range) {
+    return rand() % (2 * range + 1) - range;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+
+    /* self-intersecting star differs by rule */
+    static const tft_point star[] = {{64, 5}, {100, 150}, {5, 55}, {123, 55}, {28, 150}};
+    CHECK(!check_polygon(star, 5, false, 0, 0, W, H), "even-odd star");
+    CHECK(!check_polygon(star, 5, true, 0, 0, W, H), "non-zero star");
+
+    /* edges from the range of int16_t: products of coordinates overflow
+     * 16 bits and slopes are below one pixel per row
+     */
+    static const tft_point huge[][4] = {
+        {{-32767, -32767}, {32767, -32000}, {200, 32767}, {-30000, 100}},
+        {{-32768, 80}, {32767, 40}, {32767, 120}, {-32768, 90}},
+        {{60, -32768}, {70, -32768}, {65, 32767}, {64, 32767}},
+        {{32767, 32767}, {-32768, 32767}, {64, 0}, {0, 0}},
+    };
+    for (uint8_t i = 0; i < sizeof(huge) / sizeof(huge[0]); i++) {
+        CHECK(!check_polygon(huge[i], 4, false, 0, 0, W, H), "huge polygon %u", i);
+        CHECK(!check_polygon(huge[i], 4, true, 10, 20, 100, 120),
+              "huge polygon %u in viewport", i);
+    }
+
+    /* random polygons on and around the screen, and with huge coordinates */
+    srand(3);
+    for (int i = 0; i < 200; i++) {
+        tft_point pts[TFT_POLY_MAX];
+        uint8_t n = rand() % (TFT_POLY_MAX - 2) + 3;
+        int16_t range = (i < 150) ? 200 : 32767;
+        int16_t vx = rand() % 40, vy = rand() % 40;
+
+        for (uint8_t j = 0; j < n; j++) {
+            pts[j].x = random_coord(range) + W / 2;
+            pts[j].y = random_coord(range) + H / 2;
+            if (range > 200) {
+                pts[j].x -= W / 2;
+                pts[j].y -= H / 2;
+            }
+        }
+        CHECK(!check_polygon(pts, n, i & 1, vx, vy, W - vx, H - vy), "random polygon %d", i);
+    }
+
+    CHECK(!emu_bad_cmds, "%ld unknown commands", emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+    return emu_done(argv[0]);
+}
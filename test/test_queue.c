@@ -0,0 +1,153 @@
+/* Transfers of drawing: synchronous, queued with polling, queued with
+ * SPI interrupt (EMU_ISR) and to two displays (TFT_DEVICES > 1).
+ * Random drawing is compared to a model of the screen.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <util/delay.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define W TFT_WIDTH
+#define H TFT_HEIGHT
+
+static uint16_t model[EMU_PANELS][H][W];
+static uint8_t dev;     // selected display
+static bool color12[EMU_PANELS];
+static long inversions;
+
+static void model_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+    if (color12[dev])
+        c = emu_444_to_565(rgb565_to_444(c));
+    for (int16_t j = y; j < y + h; j++)
+        for (int16_t i = x; i < x + w; i++)
+            if (i >= 0 && i < W && j >= 0 && j < H)
+                model[dev][j][i] = c;
+}
+
+static void select_dev(uint8_t n) {
+#if TFT_DEVICES > 1
+    ST7735_select(ST7735_get_dev(n));
+    dev = n;
+#else
+    (void)n;
+#endif
+}
+
+static void check_screen(const char *step) {
+    ST7735_wait_idle();
+    CHECK(emu_spi_idle(), "%s: bus is not idle after ST7735_wait_idle()", step);
+    for (uint8_t n = 0; n < EMU_PANELS && n < TFT_DEVICES; n++) {
+        int errors = 0;
+
+        for (int y = 0; y < H; y++)
+            for (int x = 0; x < W; x++)
+                if (emu_px565(n, x, y) != model[n][y][x] && !errors++)
+                    CHECK(0, "%s: display %u pixel (%d,%d) %04X, expected %04X", step, n, x, y,
+                          emu_px565(n, x, y), model[n][y][x]);
+        CHECK(!errors, "%s: display %u: %d pixels differ", step, n, errors);
+    }
+    CHECK(emu_panels[0].cmds[ST7735_INVON] + emu_panels[0].cmds[ST7735_INVOFF] == inversions,
+          "%s: inversion commands lost", step);
+    CHECK(!emu_bad_cmds, "%s: %ld unknown commands (data sent as command)", step, emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%s: %ld bus errors", step, emu_bus_errors);
+}
+
+/* Random shapes; the queue wraps many times and runs have all lengths */
+static void random_drawing(unsigned seed, int ops) {
+    srand(seed);
+    for (int i = 0; i < ops; i++) {
+        int16_t x = rand() % (W + 20) - 10, y = rand() % (H + 20) - 10;
+        int16_t w = rand() % 40 + 1, h = rand() % 40 + 1;
+        uint16_t c = rand();
+
+        /* let the queue drain, so records are also added to an idle queue */
+        if (rand() % 8 == 0)
+            _delay_us(1);
+#if TFT_DEVICES > 1
+        if (rand() % 4 == 0)
+            select_dev(rand() % 2);
+#endif
+        switch (rand() % 6) {
+            case 0:
+                ST7735_draw_pixel(x, y, c);
+                model_rect(x, y, 1, 1, c);
+                break;
+            case 1:
+                ST7735_draw_Hline(x, y, w, c);
+                model_rect(x, y, w, 1, c);
+                break;
+            case 2:
+                ST7735_draw_Vline(x, y, h, c);
+                model_rect(x, y, 1, h, c);
+                break;
+            case 3:
+                if (dev == 0) {
+                    ST7735_invert_display(rand() & 1);
+                    inversions++;
+                }
+                break;
+            default:
+                ST7735_draw_fill_rect(x, y, w, h, c);
+                model_rect(x, y, w, h, c);
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+#ifdef EMU_ISR
+    emu_isr_start(1);
+#endif
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+#if TFT_DEVICES > 1
+    select_dev(1);
+    ST7735_init(2, &PORTD, 1, &PORTB, 0, &PORTD);
+    select_dev(0);
+#endif
+    check_screen("init");
+
+    ST7735_fill_screen(0x1234);
+    model_rect(0, 0, W, H, 0x1234);
+    check_screen("fill screen");
+
+    random_drawing(1, 2000);
+    check_screen("random");
+
+    /* long runs of a repeated pixel */
+    select_dev(0);
+    for (uint16_t c = 0; c < 8; c++) {
+        ST7735_draw_fill_rect(0, 0, W, H, c * 0x1111);
+        ST7735_invert_display(c & 1);
+        inversions++;
+    }
+    model_rect(0, 0, W, H, 7 * 0x1111);
+    check_screen("runs");
+    CHECK(emu_panels[0].inverted, "inversion is not set by the last command");
+
+    for (uint8_t n = 0; n < TFT_DEVICES; n++) {
+        select_dev(n);
+        ST7735_color_12bit(true);
+        color12[n] = true;
+    }
+    select_dev(0);
+    for (int16_t w = 1; w < 8; w++) {
+        ST7735_draw_fill_rect(3, w * 10, w, 5, w * 0x0841);
+        model_rect(3, w * 10, w, 5, w * 0x0841);
+        ST7735_draw_pixel(20 + w, 3, 0xF81F);
+        model_rect(20 + w, 3, 1, 1, 0xF81F);
+    }
+    check_screen("12-bit odd widths");
+    random_drawing(2, 500);
+    check_screen("12-bit random");
+
+#ifdef EMU_ISR
+    emu_isr_stop();
+#endif
+    return emu_done(argv[0]);
+}
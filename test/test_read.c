@@ -0,0 +1,148 @@
+/* Reading back display memory: conversion of 18-bit pixels to RGB565,
+ * SPI speed of reading, ST7735_copy_rect() and ST7735_blend_fill_rect().
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define W TFT_WIDTH
+#define H TFT_HEIGHT
+
+static uint16_t model[H][W];
+
+static void random_screen(void) {
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            model[y][x] = rand();
+            ST7735_draw_pixel(x, y, model[y][x]);
+        }
+    }
+}
+
+static int diff_screen(void) {
+    int errors = 0;
+
+    ST7735_wait_idle();
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++)
+            if ((emu_px565(0, x, y) != model[y][x]) && !errors++)
+                CHECK(0, "pixel (%d,%d) %04X, expected %04X", x, y,
+                      emu_px565(0, x, y), model[y][x]);
+    return errors;
+}
+
+/* Copy of model, source is clipped by screen, destination by clip rectangle */
+static void model_copy(int sx, int sy, int w, int h, int dx, int dy) {
+    static uint16_t src[H][W];
+
+    memcpy(src, model, sizeof(src));
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++)
+            if (sx + i >= 0 && sx + i < W && sy + j >= 0 && sy + j < H &&
+                dx + i >= 0 && dx + i < W && dy + j >= 0 && dy + j < H)
+                model[dy + j][dx + i] = src[sy + j][sx + i];
+}
+
+static void check_conversion(void) {
+    /* every 6-bit level of every channel */
+    for (uint32_t v = 0; v < 64; v++) {
+        uint32_t px = (v << 12) | (((v * 7) & 0x3F) << 6) | ((v * 13) & 0x3F);
+        uint16_t expected = ((px >> 13) << 11) | (((px >> 6) & 0x3F) << 5) | ((px & 0x3F) >> 1);
+        uint16_t c;
+
+        emu_panels[0].gram[3][v] = px;
+        c = ST7735_read_pixel(v, 3);
+        CHECK(c == expected, "18-bit pixel %05X read as %04X, expected %04X",
+              (unsigned)px, c, expected);
+    }
+
+    /* written colors are read back unchanged */
+    for (uint32_t c = 0; c < 0x10000; c += 251) {
+        ST7735_draw_pixel(5, 5, c);
+        CHECK(ST7735_read_pixel(5, 5) == c, "color %04X read as %04X",
+              (unsigned)c, ST7735_read_pixel(5, 5));
+    }
+}
+
+static void check_speed(void) {
+    uint16_t buf[40 * 20];
+    long changes = emu_speed_changes;
+
+    CHECK(ST7735_read_rect(10, 10, 40, 20, buf), "rectangle is not read");
+    CHECK(emu_speed_changes - changes == 2, "%ld speed changes in one read burst",
+          emu_speed_changes - changes);
+    for (int i = 0; i < 40 * 20; i++)
+        CHECK(buf[i] == model[10 + i / 40][10 + i % 40], "read_rect pixel %d", i);
+
+    /* one burst for every chunk of bounce buffer */
+    changes = emu_speed_changes;
+    ST7735_copy_rect(0, 0, TFT_COPY_BUF, 8, 64, 100);
+    model_copy(0, 0, TFT_COPY_BUF, 8, 64, 100);
+    CHECK(emu_speed_changes - changes == 2 * 8, "%ld speed changes in copy of 8 chunks",
+          emu_speed_changes - changes);
+    CHECK(emu_speed == TFT_WRITE_FREQ, "speed is not restored after reading");
+}
+
+static void check_copy(void) {
+    static const int16_t moves[][6] = {
+        {10, 10, 50, 40, 20, 25},       // down right, overlapped
+        {20, 25, 50, 40, 10, 10},       // up left, overlapped
+        {10, 30, 70, 20, 13, 30},       // right in the same rows
+        {13, 30, 70, 20, 10, 30},       // left in the same rows
+        {40, 40, 3, 60, 40, 47},        // narrow column down
+        {-10, -5, 40, 40, 100, 140},    // clipped source and destination
+        {0, 0, W, H, 0, 1},             // whole screen
+    };
+
+    for (uint8_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+        const int16_t *m = moves[i];
+
+        ST7735_copy_rect(m[0], m[1], m[2], m[3], m[4], m[5]);
+        model_copy(m[0], m[1], m[2], m[3], m[4], m[5]);
+        CHECK(!diff_screen(), "copy %u", i);
+    }
+}
+
+static void check_blend(void) {
+    static const uint8_t alphas[] = {0, 3, 4, 100, 128, 200, 251, 252, 255};
+
+    for (uint8_t i = 0; i < sizeof(alphas); i++) {
+        uint8_t a = (alphas[i] + 4U) >> 3;
+        uint16_t color = rand();
+
+        ST7735_blend_fill_rect(-3, 20 + i * 10, 50, 7, color, alphas[i]);
+        for (int y = 20 + i * 10; y < 27 + i * 10; y++)
+            for (int x = 0; x < 47; x++)
+                model[y][x] = color_blend_565(color, model[y][x], a);
+        CHECK(!diff_screen(), "blend with alpha %u", alphas[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+#ifdef EMU_ISR
+    emu_isr_start(2);
+#endif
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+
+    check_conversion();
+    random_screen();
+    CHECK(!diff_screen(), "random screen");
+    check_speed();
+    check_copy();
+    check_blend();
+
+    CHECK(!emu_fast_reads, "%ld bytes read faster than TFT_READ_FREQ", emu_fast_reads);
+    CHECK(!emu_bad_cmds, "%ld unknown commands", emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+#ifdef EMU_ISR
+    emu_isr_stop();
+#endif
+    return emu_done(argv[0]);
+}
@@ -0,0 +1,70 @@
+/* Frame update synchronized to TE. A row is torn if the scan shows it
+ * from another refresh than the other rows of the frame.
+ * Built with the default TFT_TE_DELAY and with TFT_TE_DELAY=0.
+ */
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+/* Rows of the frame shown by another refresh than the first row */
+static int torn_rows(void) {
+    struct emu_panel *p = &emu_panels[0];
+    long first = emu_refresh(p->row_time[0], 0);
+    int torn = 0;
+
+    for (uint16_t r = 1; r < TFT_HEIGHT; r++)
+        torn += (emu_refresh(p->row_time[r], r) != first);
+    return torn;
+}
+
+/* Frames of full screen fill; returns torn frames */
+static int frames(double byte_us, uint8_t n) {
+    int torn = 0;
+
+    emu_byte_us = byte_us;
+    for (uint8_t i = 0; i < n; i++) {
+        ST7735_frame_begin();
+        ST7735_fill_screen(i & 1 ? 0xFFFF : 0x0000);
+        ST7735_frame_end();
+        torn += !!torn_rows();
+    }
+    emu_byte_us = 0;
+    return torn;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+    ST7735_te_on(EMU_TE_PIN, &PORTD);
+    CHECK(emu_panels[0].cmds[ST7735_TEON] == 1, "TE is not enabled");
+
+    /* a row of SPI write is slower than the scan of a row,
+     * the frame is shorter than a refresh period
+     */
+    double slow = 2.5 * emu_line_us / (TFT_WIDTH * 2);
+
+#if TFT_TE_DELAY > 0
+    CHECK(!frames(slow, 6), "slow update is torn");
+#else
+    /* the whole frame is written in V-blanking */
+    double fast = 0.5 * emu_porch_lines * emu_line_us / (TFT_WIDTH * TFT_HEIGHT * 2);
+
+    CHECK(frames(slow, 6) == 6, "slow update is not overtaken by the scan");
+    CHECK(!frames(fast, 6), "fast update is torn");
+#endif
+
+#ifdef TFT_TICKS
+    const tft_frame_stats *st = ST7735_frame_stats();
+    uint16_t update_ms = slow * TFT_WIDTH * TFT_HEIGHT * 2 / 1000;
+
+    CHECK(st->frames == 6, "%u frames counted", st->frames);
+    CHECK(st->update_time >= update_ms && st->update_time <= update_ms + 1,
+          "update time %u ms, expected %u ms", st->update_time, update_ms);
+    CHECK(st->max_update_time >= st->update_time, "max update time %u ms", st->max_update_time);
+    CHECK(!st->missed, "%u missed vsyncs with polled TE", st->missed);
+#endif
+
+    return emu_done(argv[0]);
+}
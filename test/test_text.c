@@ -0,0 +1,148 @@
+/* Text: bytes above ASCII are CP437 codes, or UTF-8 with TFT_UTF8,
+ * on the stream and in ST7735_draw_text(); breaking text into lines
+ * by words, with tabs and carriage returns.
+ */
+#include <string.h>
+
+#include <avr/io.h>
+#include "ST7735.h"
+#include "emu.h"
+
+#define W TFT_WIDTH
+#define ROWS 16
+
+static uint16_t shot[2][ROWS][W];
+
+static void capture(uint8_t k) {
+    ST7735_wait_idle();
+    for (int y = 0; y < ROWS; y++)
+        for (int x = 0; x < W; x++)
+            shot[k][y][x] = emu_px565(0, x, y);
+}
+
+/* Print string on the stream at the top left corner */
+static void print(uint8_t k, const char *s, bool sym) {
+    ST7735_fill_screen(0);
+    ST7735_symbol_text(sym);
+    ST7735_set_cursor(0, 0);
+    while (*s)
+        ST7735_put_char(*s++, ST7735_get_stream());
+    capture(k);
+}
+
+/* Check that string is printed in char mode and drawn as symbols */
+static void check_text(const char *s, const char *symbols) {
+    int16_t w = strlen(symbols) * 6;
+
+    print(1, symbols, true);
+    print(0, s, false);
+    CHECK(!memcmp(shot[0], shot[1], sizeof(shot[0])), "\"%s\" is printed wrong", s);
+
+    ST7735_fill_screen(0);
+    ST7735_draw_text(0, 0, 0, s, TFT_ALIGN_LEFT);
+    capture(0);
+    CHECK(!memcmp(shot[0], shot[1], sizeof(shot[0])), "\"%s\" is drawn wrong", s);
+    CHECK(ST7735_text_width(s, strlen(s)) == w, "\"%s\" width %d, expected %d", s,
+          ST7735_text_width(s, strlen(s)), w);
+}
+
+/* Check lines of text laid out in width w; lines are {start, len, w} */
+static void check_layout(const char *s, int16_t w, const tft_text_line *lines, uint8_t n) {
+    tft_text_line ln[8];
+    uint8_t cnt = ST7735_layout_text(s, w, ln, 8);
+    int16_t bw, bh, max_w = 0;
+
+    CHECK(cnt == n, "\"%s\" in %d: %u lines, expected %u", s, w, cnt, n);
+    for (uint8_t i = 0; i < n && i < cnt; i++) {
+        CHECK(!memcmp(&ln[i], &lines[i], sizeof(ln[i])),
+              "\"%s\" in %d: line %u is {%u, %u, %d}, expected {%u, %u, %d}", s, w, i,
+              ln[i].start, ln[i].len, ln[i].w, lines[i].start, lines[i].len, lines[i].w);
+        if (lines[i].w > max_w)
+            max_w = lines[i].w;
+    }
+    ST7735_text_bounds(s, w, &bw, &bh);
+    CHECK((bw == max_w) && (bh == n * 8), "\"%s\" in %d: bounds %dx%d", s, w, bw, bh);
+}
+
+static void check_layouts(void) {
+    static const tft_text_line words[] = {{0, 5, 30}, {6, 5, 30}};
+    static const tft_text_line line[] = {{0, 11, 66}};
+    static const tft_text_line long_word[] = {{0, 5, 30}, {5, 5, 30}, {10, 2, 12}};
+    static const tft_text_line spaces[] = {{0, 2, 12}, {5, 2, 12}};
+    static const tft_text_line newlines[] = {{0, 2, 12}, {3, 0, 0}, {4, 2, 12}};
+    static const tft_text_line tab[] = {{0, 5, 30}};
+    static const tft_text_line tab_break[] = {{0, 2, 12}, {3, 2, 12}};
+    static const tft_text_line crlf[] = {{0, 2, 12}, {4, 2, 12}};
+    static const tft_text_line blanks[] = {{0, 2, 12}, {5, 2, 12}};
+
+    check_layout("hello world", 60, words, 2);
+    check_layout("hello world", 66, line, 1);
+    check_layout("hello world", 0, line, 1);
+    check_layout("abcdefghijkl", 30, long_word, 3);
+    check_layout("ab   cd", 18, spaces, 2);
+    check_layout("ab\n\ncd", 0, newlines, 3);
+
+    /* tab is a space and a break point, carriage return takes no width */
+    check_layout("ab\tcd", 0, tab, 1);
+    check_layout("ab\tcd", 24, tab_break, 2);
+    check_layout("ab\r\ncd\r", 0, crlf, 2);
+    check_layout("ab\t\r\tcd", 18, blanks, 2);
+    CHECK(ST7735_text_width("a\rb\tc", 5) == 24, "width of \"a\\rb\\tc\" is %d",
+          ST7735_text_width("a\rb\tc", 5));
+
+    /* neither is drawn by its CP437 glyph */
+    ST7735_fill_screen(0);
+    ST7735_draw_text(0, 0, 0, "a b", TFT_ALIGN_LEFT);
+    capture(1);
+    ST7735_fill_screen(0);
+    ST7735_draw_text(0, 0, 0, "a\tb\r", TFT_ALIGN_LEFT);
+    capture(0);
+    CHECK(!memcmp(shot[0], shot[1], sizeof(shot[0])), "tab or carriage return is drawn");
+    ST7735_fill_screen(0);
+    ST7735_draw_text(60, 0, 0, "a\rb\r\n", TFT_ALIGN_RIGHT);
+    capture(0);
+    ST7735_fill_screen(0);
+    ST7735_draw_text(60, 0, 0, "ab", TFT_ALIGN_RIGHT);
+    capture(1);
+    CHECK(!memcmp(shot[0], shot[1], sizeof(shot[0])), "carriage return takes width");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    PORTB |= _BV(2);
+    PORTD |= _BV(2);
+    ST7735_init(2, &PORTB, 1, &PORTB, 0, &PORTB);
+    ST7735_pix_text(true);
+    ST7735_set_text_color(0xFFFF);
+    ST7735_set_text_bg_color(0x0010);
+
+    check_text("A", "A");
+#ifdef TFT_UTF8
+    check_text("\xC3\x84" "b", "\x8E" "b");         // Ä
+    check_text("x\xE2\x99\xAB", "x\x0E");           // ♫ is not a control char
+    check_text("\xC3" "A", "?A");                   // cut short
+    check_text("\x80" "A", "?A");                   // stray continuation byte
+    check_text("\xE0\x80\x80" "A", "?A");           // overlong
+    check_text("\xE2\x82\xAC", "?");                // not in CP437
+#else
+    check_text("\xC3\x84" "b", "\xC3\x84" "b");
+    check_text("\x8E\x80\xE0", "\x8E\x80\xE0");
+#endif
+
+    /* symbol mode prints bytes */
+    print(0, "\xC3\x84", true);
+    print(1, "\xC3\x84", true);
+    ST7735_symbol_text(true);
+    ST7735_fill_screen(0);
+    ST7735_draw_text(0, 0, 0, "\xC3\x84", TFT_ALIGN_LEFT);
+    capture(0);
+    CHECK(!memcmp(shot[0], shot[1], sizeof(shot[0])), "symbols are drawn wrong");
+    ST7735_symbol_text(false);
+
+    check_layouts();
+
+    CHECK(!emu_bad_cmds, "%ld unknown commands", emu_bad_cmds);
+    CHECK(!emu_bus_errors, "%ld bus errors", emu_bus_errors);
+
+    return emu_done(argv[0]);
+}
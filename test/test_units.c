@@ -0,0 +1,62 @@
+/* Helpers of the driver, checked against reference implementations:
+ * color blend and integer square roots.
+ * The driver is included to reach its static functions.
+ */
+#include "ST7735.c"
+#include "emu.h"
+
+/* Blend of one channel: bg + (fg - bg) * alpha / 32, rounded down */
+static int blend_ch(int fg, int bg, int alpha) {
+    int d = (fg - bg) * alpha;
+
+    return bg + ((d >= 0) ? (d >> 5) : -((31 - d) >> 5));
+}
+
+static void check_blend(void) {
+    long errors = 0;
+
+    for (uint32_t fg = 0; fg < 0x10000; fg += 97) {
+        for (uint32_t bg = 0; bg < 0x10000; bg += 89) {
+            CHECK(color_blend_565(fg, bg, 0) == bg, "%04X over %04X, alpha 0", fg, bg);
+            CHECK(color_blend_565(fg, bg, 32) == fg, "%04X over %04X, alpha 32", fg, bg);
+            for (uint8_t a = 1; a < 32; a++) {
+                uint16_t c = color_blend_565(fg, bg, a);
+                uint16_t r = blend_ch(fg >> 11, bg >> 11, a);
+                uint16_t g = blend_ch((fg >> 5) & 0x3F, (bg >> 5) & 0x3F, a);
+                uint16_t b = blend_ch(fg & 0x1F, bg & 0x1F, a);
+
+                if ((c != ((r << 11) | (g << 5) | b)) && !errors++)
+                    CHECK(0, "%04X over %04X, alpha %u: %04X, expected %04X", fg, bg, a, c,
+                          (r << 11) | (g << 5) | b);
+            }
+        }
+    }
+    CHECK(!errors, "color_blend_565: %ld errors", errors);
+}
+
+/* r is floor of square root of v */
+static bool is_isqrt(uint64_t v, uint64_t r) {
+    return (r * r <= v) && ((r + 1) * (r + 1) > v);
+}
+
+static void check_isqrt(void) {
+    for (uint32_t v = 0; v < 0x10000; v++)
+        CHECK(is_isqrt(v, isqrt16(v)), "isqrt16(%u) = %u", v, isqrt16(v));
+
+    /* around every square of 32-bit range */
+    for (uint32_t k = 1; k < 0x10000; k++) {
+        uint32_t sq = k * k;
+        uint32_t vals[] = {sq - 1, sq, sq + k, sq + 2 * k};
+
+        for (uint8_t i = 0; i < 4; i++)
+            CHECK(is_isqrt(vals[i], isqrt32(vals[i])), "isqrt32(%u) = %u", vals[i], isqrt32(vals[i]));
+    }
+    CHECK(isqrt32(0xFFFFFFFFUL) == 0xFFFF, "isqrt32(0xFFFFFFFF) = %u", isqrt32(0xFFFFFFFFUL));
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    check_blend();
+    check_isqrt();
+    return emu_done(argv[0]);
+}
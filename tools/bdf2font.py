@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+Convert a BDF font to a proportional font for ST7735_set_font().
+
+Glyph bitmaps are trimmed to their ink and packed bit by bit without row
+padding. Char codes are split into ranges of consecutive codes, so only
+the glyphs that are present take flash.
+
+With --cp437 glyphs of a Unicode BDF are stored by CP437 codes, which
+the console stream prints for UTF-8 text.
+
+Anti-aliased fonts (--bpp 2 or 4) are made from a BDF drawn --ss times
+larger: each ss x ss block becomes one pixel with alpha of its ink.
+
+    bdf2font.py font.bdf name [-r 32-126] [-r 0xB0] [--cp437] [--bpp 4 --ss 4] > name.h
+
+The header defines `const tft_font name PROGMEM`; include it in one
+source file and pass `&name` to ST7735_set_font().
+"""
+import argparse
+import sys
+
+
+def parse_bdf(path):
+    """Return (ascent, descent, {code: glyph}) of a BDF file"""
+    ascent = descent = None
+    glyphs = {}
+    glyph = None
+    rows = None
+    with open(path, encoding='latin-1') as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            key = words[0]
+            if rows is not None:
+                if key == 'ENDCHAR':
+                    glyph['rows'] = rows
+                    if glyph['code'] >= 0:
+                        glyphs[glyph['code']] = glyph
+                    glyph = rows = None
+                else:
+                    rows.append(int(key, 16))
+            elif key == 'FONT_ASCENT':
+                ascent = int(words[1])
+            elif key == 'FONT_DESCENT':
+                descent = int(words[1])
+            elif key == 'STARTCHAR':
+                glyph = {'name': ' '.join(words[1:]), 'code': -1}
+            elif key == 'ENCODING':
+                glyph['code'] = int(words[-1])
+            elif key == 'DWIDTH':
+                glyph['adv'] = int(words[1])
+            elif key == 'BBX':
+                glyph['bbx'] = [int(w) for w in words[1:5]]
+            elif key == 'BITMAP':
+                rows = []
+    if ascent is None or descent is None:
+        sys.exit('%s: FONT_ASCENT/FONT_DESCENT missing' % path)
+    return ascent, descent, glyphs
+
+
+def glyph_pixels(glyph, bpp, ss):
+    """Return (pixels, x_off, y_top) of glyph trimmed to its ink.
+    Pixels are alpha [0:2^bpp - 1] of ss x ss blocks of BDF pixels."""
+    w, h, x_off, y_off = glyph['bbx']
+    nbytes = (w + 7) // 8
+    ink = [[(row >> (nbytes * 8 - 1 - x)) & 1 for x in range(w)]
+           for row in glyph['rows'][:h]]
+    y_top = -(y_off + h)
+    # blocks are aligned to the origin
+    x0, y0 = x_off // ss, y_top // ss
+    x1, y1 = -(-(x_off + w) // ss), -(-(y_top + h) // ss)
+    top = (1 << bpp) - 1
+    pixels = []
+    for by in range(y0, y1):
+        row = []
+        for bx in range(x0, x1):
+            n = sum(ink[y - y_top][x - x_off]
+                    for y in range(max(by * ss, y_top), min(by * ss + ss, y_top + h))
+                    for x in range(max(bx * ss, x_off), min(bx * ss + ss, x_off + w)))
+            row.append((n * top + ss * ss // 2) // (ss * ss))
+        pixels.append(row)
+    x_off, y_top = x0, y0
+    while pixels and not any(pixels[0]):
+        pixels.pop(0)
+        y_top += 1
+    while pixels and not any(pixels[-1]):
+        pixels.pop()
+    if not pixels:
+        return [], 0, 0
+    while not any(row[0] for row in pixels):
+        pixels = [row[1:] for row in pixels]
+        x_off += 1
+    while not any(row[-1] for row in pixels):
+        pixels = [row[:-1] for row in pixels]
+    return pixels, x_off, y_top
+
+
+# Unicode of CP437 codes 0x01-0x1F and 0x7F; others are from the codec
+CP437_LOW = '\u263A\u263B\u2665\u2666\u2663\u2660\u2022\u25D8\u25CB\u25D9\u2642\u2640' \
+            '\u266A\u266B\u263C\u25BA\u25C4\u2195\u203C\u00B6\u00A7\u25AC\u21A8\u2191' \
+            '\u2193\u2192\u2190\u221F\u2194\u25B2\u25BC'
+
+
+def cp437_glyphs(glyphs):
+    """Return glyphs of a Unicode font by CP437 codes"""
+    out = {}
+    for code in range(1, 256):
+        if code < 0x20:
+            u = ord(CP437_LOW[code - 1])
+        elif code == 0x7F:
+            u = 0x2302
+        else:
+            u = ord(bytes([code]).decode('cp437'))
+        if u in glyphs:
+            out[code] = glyphs[u]
+    return out
+
+
+def parse_range(s):
+    a, _, b = s.partition('-')
+    a = int(a, 0)
+    b = int(b, 0) if b else a
+    if not 0 <= a <= b <= 255:
+        raise argparse.ArgumentTypeError('bad range %s' % s)
+    return a, b
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n\n')[1],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('bdf')
+    ap.add_argument('name', help='C name of the font')
+    ap.add_argument('-r', '--range', action='append', type=parse_range,
+                    help='char codes to convert, e.g. 32-126 (default: 32-126)')
+    ap.add_argument('--cp437', action='store_true',
+                    help='store glyphs of Unicode BDF by CP437 codes')
+    ap.add_argument('--bpp', type=int, choices=(1, 2, 4), default=1,
+                    help='bits of alpha per pixel (default: 1)')
+    ap.add_argument('--ss', type=int, default=1,
+                    help='BDF pixels per font pixel (default: 1)')
+    args = ap.parse_args()
+    bpp, ss = args.bpp, args.ss
+    if ss < 1:
+        sys.exit('bad --ss')
+
+    ascent, descent, glyphs = parse_bdf(args.bdf)
+    if args.cp437:
+        glyphs = cp437_glyphs(glyphs)
+    ascent, descent = -(-ascent // ss), -(-descent // ss)
+    codes = set()
+    for a, b in args.range or [(32, 126)]:
+        codes.update(c for c in range(a, b + 1) if c in glyphs)
+    codes = sorted(codes)
+    if not codes:
+        sys.exit('no glyphs in range')
+
+    bits = []
+    out_glyphs = []
+    ranges = []
+    width = 0
+    for code in codes:
+        g = glyphs[code]
+        pixels, x_off, y_top = glyph_pixels(g, bpp, ss)
+        w = len(pixels[0]) if pixels else 0
+        h = len(pixels)
+        adv = (g.get('adv', g['bbx'][0]) + ss // 2) // ss
+        if adv > 32 or x_off + w > 32 or not -128 <= y_top <= 127:
+            sys.exit('glyph %d is too large' % code)
+        if len(bits) + w * h * bpp > 0xFFFF:
+            sys.exit('bitmap is too large')
+        width = max(width, adv, x_off + w)
+        if ranges and ranges[-1][1] == code - 1:
+            ranges[-1][1] = code
+        else:
+            ranges.append([code, code, len(out_glyphs)])
+        out_glyphs.append((len(bits), w, h, adv, x_off, y_top, g['name']))
+        for row in pixels:
+            for v in row:
+                bits.extend((v >> i) & 1 for i in reversed(range(bpp)))
+    bits.extend([0] * (-len(bits) % 8))
+    bitmap = [int(''.join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8)]
+
+    n = args.name
+    size = len(bitmap) + 7 * len(out_glyphs) + 4 * len(ranges) + 11
+    print('/* %s: %d glyphs, %d ranges, %d bytes; made by bdf2font.py */'
+          % (n, len(out_glyphs), len(ranges), size))
+    print('#include <avr/pgmspace.h>\n')
+    print('#include "ST7735.h"\n')
+    print('static const uint8_t %s_bitmap[] PROGMEM = {' % n)
+    for i in range(0, len(bitmap), 12):
+        print('    ' + ' '.join('0x%02X,' % b for b in bitmap[i:i + 12]))
+    print('};\n')
+    print('static const tft_glyph %s_glyphs[] PROGMEM = {' % n)
+    for off, w, h, adv, x_off, y_top, name in out_glyphs:
+        print('    {%5d, %2d, %2d, %2d, %3d, %3d},    // %s' % (off, w, h, adv, x_off, y_top, name))
+    print('};\n')
+    print('static const tft_font_range %s_ranges[] PROGMEM = {' % n)
+    for a, b, i in ranges:
+        print('    {0x%02X, 0x%02X, %d},' % (a, b, i))
+    print('};\n')
+    print('const tft_font %s PROGMEM = {' % n)
+    print('    %s_bitmap, %s_glyphs, %s_ranges, %d, %d, %d, %d, %d' % (
+        n, n, n, len(ranges), width, ascent + descent, ascent, bpp))
+    print('};')
+
+
+if __name__ == '__main__':
+    main()